@@ -0,0 +1,325 @@
+#pragma once
+
+#define FF_AFFINE_3F
+
+#include <math.h>
+#include <stdlib.h>
+#include <iostream>
+#include <cstring>
+#include <float.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FF_AFFINE_3F_SSE
+#endif
+
+#include "Matrix4f.hpp"
+
+/* Row Major storage, the last row is always (0, 0, 0, 1) and is not stored.
+0  1  2  3
+4  5  6  7
+8  9  10 11
+
+Each row is 16 byte aligned, so the whole thing can be uploaded as three
+std140 vec4s (48 bytes instead of the 64 of a Matrix4f).
+Unpack it on the shader side with shaders/affine.glsl
+*/
+
+struct alignas(16) Affine3f
+{
+	float v[12];
+
+	Affine3f() {} //Default constructor, does nothing, v has undefined values
+
+	Affine3f(const float value[12])
+	{
+		memcpy(v, value, sizeof(value[0]) * 12);
+	}
+
+	Affine3f(std::initializer_list<float> init)
+	{
+		std::copy(init.begin(), init.end(), v);
+	}
+
+	inline float operator[](int i) const { return v[i]; }
+	inline float& operator[](int i) { return v[i]; }
+
+	//Same argument order as Matrix4f::get, so code can be swapped between the two.
+	inline float get(int col, int line) const { return v[line * 4 + col]; }
+	inline float& get(int col, int line) { return v[line * 4 + col]; }
+
+	inline float* get_row(int line) { return &v[line * 4]; }
+
+	inline Affine3f& operator*=(const Affine3f& a);
+
+	inline Affine3f invert() const;
+
+	inline float determinant() const;
+
+	inline Matrix4f to_matrix4f() const;
+};
+
+static inline Affine3f a3f_identity()
+{
+	return
+	{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f
+	};
+}
+
+//Drops the last row of m, which is assumed to be (0, 0, 0, 1).
+static inline Affine3f a3f_from_matrix4f(const Matrix4f& m)
+{
+	Affine3f result;
+
+	for(int l = 0; l < 3; l++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			result.get(c, l) = m.get(c, l);
+		}
+	}
+
+	return result;
+}
+
+inline Matrix4f Affine3f::to_matrix4f() const
+{
+	Matrix4f result;
+
+	for(int c = 0; c < 4; c++)
+	{
+		for(int l = 0; l < 3; l++)
+		{
+			result.get(c, l) = get(c, l);
+		}
+	}
+
+	result.get(0, 3) = 0.0f;
+	result.get(1, 3) = 0.0f;
+	result.get(2, 3) = 0.0f;
+	result.get(3, 3) = 1.0f;
+
+	return result;
+}
+
+inline std::ostream& operator<< (std::ostream& os, const Affine3f& t)
+{
+	for(int l = 0; l < 3; l++)
+	{
+		os << t.get(0, l) << "\t" << t.get(1, l) << "\t" << t.get(2, l) << "\t" << t.get(3, l) << "\n";
+	}
+	os << "0\t0\t0\t1\n";
+	return os;
+}
+
+//Composes two transforms, the result applies a2 first and then a1. (Same as Matrix4f)
+//Each row of the result is a linear combination of the rows of a2, which maps
+//directly onto 4 wide SIMD, 36 multiplies against the 64 of Matrix4f.
+inline Affine3f operator*(const Affine3f& a1, const Affine3f& a2)
+{
+	Affine3f result;
+
+#ifdef FF_AFFINE_3F_SSE
+	__m128 row_0 = _mm_load_ps(&a2.v[0]);
+	__m128 row_1 = _mm_load_ps(&a2.v[4]);
+	__m128 row_2 = _mm_load_ps(&a2.v[8]);
+
+	for(int l = 0; l < 3; l++)
+	{
+		const float* a = &a1.v[l * 4];
+
+		__m128 r = _mm_mul_ps(_mm_set1_ps(a[0]), row_0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[1]), row_1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[2]), row_2));
+		r = _mm_add_ps(r, _mm_set_ps(a[3], 0.0f, 0.0f, 0.0f));
+
+		_mm_store_ps(&result.v[l * 4], r);
+	}
+#else
+	for(int l = 0; l < 3; l++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			result.get(c, l) =	a1.get(0, l) * a2.get(c, 0) +
+								a1.get(1, l) * a2.get(c, 1) +
+								a1.get(2, l) * a2.get(c, 2);
+		}
+
+		result.get(3, l) += a1.get(3, l);
+	}
+#endif
+
+	return result;
+}
+
+inline Affine3f& Affine3f::operator*=(const Affine3f& a)
+{
+	*this = *this * a;
+
+	return *this;
+}
+
+//Mixed products, for when one side is a full projective matrix.
+inline Matrix4f operator*(const Matrix4f& m, const Affine3f& a)
+{
+	return m * a.to_matrix4f();
+}
+
+inline Matrix4f operator*(const Affine3f& a, const Matrix4f& m)
+{
+	return a.to_matrix4f() * m;
+}
+
+inline float Affine3f::determinant() const
+{
+	return	v[0] * (v[5] * v[10] - v[6] * v[9]) -
+			v[1] * (v[4] * v[10] - v[6] * v[8]) +
+			v[2] * (v[4] * v[9]  - v[5] * v[8]);
+}
+
+//Inverts the transform, the linear part through its adjugate and the
+//translation as -(L^-1 * t). Singular transforms produce non finite values.
+inline Affine3f Affine3f::invert() const
+{
+	float inv_det = 1.0f / determinant();
+
+	Affine3f result;
+
+	result.v[0]  =  (v[5] * v[10] - v[6] * v[9]) * inv_det;
+	result.v[1]  = -(v[1] * v[10] - v[2] * v[9]) * inv_det;
+	result.v[2]  =  (v[1] * v[6]  - v[2] * v[5]) * inv_det;
+
+	result.v[4]  = -(v[4] * v[10] - v[6] * v[8]) * inv_det;
+	result.v[5]  =  (v[0] * v[10] - v[2] * v[8]) * inv_det;
+	result.v[6]  = -(v[0] * v[6]  - v[2] * v[4]) * inv_det;
+
+	result.v[8]  =  (v[4] * v[9]  - v[5] * v[8]) * inv_det;
+	result.v[9]  = -(v[0] * v[9]  - v[1] * v[8]) * inv_det;
+	result.v[10] =  (v[0] * v[5]  - v[1] * v[4]) * inv_det;
+
+	for(int l = 0; l < 3; l++)
+	{
+		result.v[l * 4 + 3] = -(result.v[l * 4 + 0] * v[3] +
+								result.v[l * 4 + 1] * v[7] +
+								result.v[l * 4 + 2] * v[11]);
+	}
+
+	return result;
+}
+
+#ifdef FF_VECTOR_3F
+	//Transforms a point, translation included.
+	inline Vector3f a3f_transform_point(const Affine3f& a, const Vector3f& p)
+	{
+		return Vector3f(a.v[0] * p.v[0] + a.v[1] * p.v[1] + a.v[2]  * p.v[2] + a.v[3],
+						a.v[4] * p.v[0] + a.v[5] * p.v[1] + a.v[6]  * p.v[2] + a.v[7],
+						a.v[8] * p.v[0] + a.v[9] * p.v[1] + a.v[10] * p.v[2] + a.v[11]);
+	}
+
+	//Transforms a direction, translation ignored.
+	inline Vector3f a3f_transform_vector(const Affine3f& a, const Vector3f& d)
+	{
+		return Vector3f(a.v[0] * d.v[0] + a.v[1] * d.v[1] + a.v[2]  * d.v[2],
+						a.v[4] * d.v[0] + a.v[5] * d.v[1] + a.v[6]  * d.v[2],
+						a.v[8] * d.v[0] + a.v[9] * d.v[1] + a.v[10] * d.v[2]);
+	}
+
+	inline Vector3f operator*(const Affine3f& a, const Vector3f& p)
+	{
+		return a3f_transform_point(a, p);
+	}
+
+	//Transforms count points, columns are kept in registers for the whole batch.
+	inline void a3f_transform_points(	const Affine3f& a,
+										const Vector3f* ptr_in,
+										Vector3f* ptr_out,
+										size_t count)
+	{
+#ifdef FF_AFFINE_3F_SSE
+		__m128 col_0 = _mm_set_ps(0.0f, a.v[8],  a.v[4], a.v[0]);
+		__m128 col_1 = _mm_set_ps(0.0f, a.v[9],  a.v[5], a.v[1]);
+		__m128 col_2 = _mm_set_ps(0.0f, a.v[10], a.v[6], a.v[2]);
+		__m128 col_3 = _mm_set_ps(0.0f, a.v[11], a.v[7], a.v[3]);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			const float* p = ptr_in[i].v;
+
+			__m128 r = _mm_add_ps(col_3, _mm_mul_ps(_mm_set1_ps(p[0]), col_0));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(p[1]), col_1));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(p[2]), col_2));
+
+			alignas(16) float out[4];
+			_mm_store_ps(out, r);
+
+			ptr_out[i] = Vector3f(out[0], out[1], out[2]);
+		}
+#else
+		for(size_t i = 0; i < count; i++)
+		{
+			ptr_out[i] = a3f_transform_point(a, ptr_in[i]);
+		}
+#endif
+	}
+
+	//Largest scale factor along any axis, used to scale bounding radii.
+	inline float a3f_max_scale(const Affine3f& a)
+	{
+		float sx = a.v[0] * a.v[0] + a.v[4] * a.v[4] + a.v[8]  * a.v[8];
+		float sy = a.v[1] * a.v[1] + a.v[5] * a.v[5] + a.v[9]  * a.v[9];
+		float sz = a.v[2] * a.v[2] + a.v[6] * a.v[6] + a.v[10] * a.v[10];
+
+		return sqrt(fmax(sx, fmax(sy, sz)));
+	}
+
+	static inline Affine3f a3f_scale(const Vector3f& amount)
+	{
+		Affine3f scale = a3f_identity();
+
+		scale.get(0, 0) = amount.x();
+		scale.get(1, 1) = amount.y();
+		scale.get(2, 2) = amount.z();
+
+		return scale;
+	}
+
+	static inline Affine3f a3f_translate(const Vector3f& amount)
+	{
+		Affine3f tran = a3f_identity();
+
+		tran.get(3, 0) = amount.x();
+		tran.get(3, 1) = amount.y();
+		tran.get(3, 2) = amount.z();
+
+		return tran;
+	}
+
+	//Same as m4f_rotate, returns rotate * a.
+	static inline Affine3f a3f_rotate(const Affine3f& a, float angle, const Vector3f& t_axis)
+	{
+		float c = cos(angle);
+		float s = sin(angle);
+
+		Vector3f axis = t_axis.unit();
+		Vector3f temp = axis * (1.0f - c);
+
+		Affine3f rotate = a3f_identity();
+
+		rotate.get(0, 0) = c + temp[0] * axis[0];
+		rotate.get(0, 1) = temp[0] * axis[1] + s * axis[2];
+		rotate.get(0, 2) = temp[0] * axis[2] - s * axis[1];
+
+		rotate.get(1, 0) = temp[1] * axis[0] - s * axis[2];
+		rotate.get(1, 1) = c + temp[1] * axis[1];
+		rotate.get(1, 2) = temp[1] * axis[2] + s * axis[0];
+
+		rotate.get(2, 0) = temp[2] * axis[0] + s * axis[1];
+		rotate.get(2, 1) = temp[2] * axis[1] - s * axis[0];
+		rotate.get(2, 2) = c + temp[2] * axis[2];
+
+		return rotate * a;
+	}
+#endif
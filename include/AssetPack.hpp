@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <vulkan/vulkan.h>
+
+//Asset pack: textures baked offline into the exact bytes VulkanTexture copies into staging,
+//so loading one is a lookup and a memcpy out of the memory mapped file, no decoding.
+//
+//Layout: AssetPackHeader, entry_count AssetPackEntry sorted by name_hash, the names,
+//then every texture's mip chain, level 0 first, each chain starting on an ASSET_PACK_ALIGNMENT boundary.
+
+static const uint32_t ASSET_PACK_MAGIC = 0x4b504646; //"FFPK"
+static const uint32_t ASSET_PACK_VERSION = 1;
+static const uint32_t ASSET_PACK_ALIGNMENT = 4096;
+
+struct AssetPackHeader
+{
+	uint32_t 	magic;
+	uint32_t 	version;
+	uint32_t 	entry_count;
+	uint32_t 	names_size;
+	uint64_t 	entries_offset;
+	uint64_t 	names_offset;
+};
+
+struct AssetPackEntry
+{
+	uint64_t 	name_hash;
+	uint32_t 	name_offset;
+	uint32_t 	name_length;
+
+	uint32_t 	format;
+	uint32_t 	width;
+	uint32_t 	height;
+	uint32_t 	level_count;
+
+	uint64_t 	data_offset;
+	uint64_t 	data_size;
+};
+
+//FNV-1a, names are the paths given to the cooker.
+uint64_t get_asset_name_hash(const char* name);
+
+//Read only view of a pack file, mapped for the lifetime of the object.
+//Throws std::runtime_error if the file can't be mapped or its index is malformed.
+struct AssetPack
+{
+	AssetPack(const char* pack_file);
+	~AssetPack();
+
+	//nullptr when the pack has no asset with that name.
+	const AssetPackEntry* find(const char* name) const;
+
+	const uint8_t* get_data(const AssetPackEntry& entry) const { return ptr_mapping + entry.data_offset; }
+
+	//Asks the kernel to start reading the entry in, so the first touch doesn't stall on a page fault.
+	void prefetch(const AssetPackEntry& entry) const;
+
+	uint8_t* 				ptr_mapping = nullptr;
+	size_t 					mapping_size = 0;
+
+	const AssetPackEntry* 	ptr_entries = nullptr;
+	uint32_t 				entry_count = 0;
+	const char* 			ptr_names = nullptr;
+};
+
+//Cooker side, one texture with its levels already packed.
+struct AssetPackTexture
+{
+	std::string 			name;
+	VkFormat 				format;
+	uint32_t 				width;
+	uint32_t 				height;
+	uint32_t 				level_count;
+	std::vector<uint8_t> 	data;
+};
+
+void save_asset_pack(const char* pack_file, std::vector<AssetPackTexture> textures);
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <cstring>
+#include <stdexcept>
+
+#include "JobPool.hpp"
+
+//Handle to an entity, generation tells a reused index apart from the entity that had it before.
+struct Entity
+{
+	uint32_t index;
+	uint32_t generation;
+};
+
+typedef uint64_t ComponentMask;
+
+static const uint32_t MAX_COMPONENT_TYPES = 64;
+static const size_t ENTITY_CHUNK_SIZE = 16 * 1024;
+
+//Components get a runtime id the first time they are used, in use order.
+uint32_t register_component_type(size_t size, size_t alignment);
+
+template<typename T>
+uint32_t get_component_id()
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Components are moved around with memcpy.");
+
+	static const uint32_t id = register_component_type(sizeof(T), alignof(T));
+	return id;
+}
+
+template<typename... T>
+ComponentMask get_component_mask()
+{
+	return (ComponentMask(0) | ... | (ComponentMask(1) << get_component_id<T>()));
+}
+
+//A fixed size block holding up to capacity entities of one archetype.
+//Inside it every component has its own array, so systems walk plain arrays.
+struct EntityChunk
+{
+	uint8_t* ptr_data;
+	uint32_t count;
+};
+
+//Every entity with exactly the same set of components lives in the same archetype.
+//Chunks are kept full except for the last one, removals swap the last entity into the hole.
+struct Archetype
+{
+	ComponentMask 			mask;
+	uint32_t 				capacity;
+	std::vector<uint32_t> 	component_ids;
+	uint32_t 				offsets[MAX_COMPONENT_TYPES];
+	uint32_t 				sizes[MAX_COMPONENT_TYPES];
+
+	std::vector<EntityChunk> chunks;
+
+	Entity* get_entities(const EntityChunk& chunk) { return reinterpret_cast<Entity*>(chunk.ptr_data); }
+
+	template<typename T>
+	T* get_array(const EntityChunk& chunk) { return reinterpret_cast<T*>(chunk.ptr_data + offsets[get_component_id<T>()]); }
+};
+
+//Archetype based component storage. Adding or removing a component moves the entity
+//to the matching archetype, destroying it is an O(1) swap-back.
+//Queries visit chunks: function(count, T*...) gets one array per requested component.
+//Component pointers are only valid until the next structural change.
+struct EntityStore
+{
+	EntityStore();
+	~EntityStore();
+
+	Entity create_entity();
+
+	//Creates the entity directly in its final archetype.
+	template<typename... T>
+	Entity create_entity(const T&... components);
+
+	void destroy_entity(Entity entity);
+	bool is_alive(Entity entity) const;
+
+	template<typename T>
+	void add_component(Entity entity, const T& component);
+
+	template<typename T>
+	void remove_component(Entity entity);
+
+	//nullptr when the entity does not have it.
+	template<typename T>
+	T* get_component(Entity entity);
+
+	template<typename... T, typename F>
+	void for_each(F function);
+
+	//Same as for_each, chunks are spread over the job pool.
+	//The function must only touch the arrays of the chunk it was handed.
+	template<typename... T, typename F>
+	void parallel_for_each(JobPool& job_pool, F function);
+
+	size_t size() const { return entity_count; }
+
+	struct EntityRecord
+	{
+		Archetype* 	ptr_archetype;
+		uint32_t 	chunk;
+		uint32_t 	row;
+		uint32_t 	generation;
+	};
+
+	std::vector<EntityRecord> 	records;
+	std::vector<uint32_t> 		free_indices;
+	size_t 						entity_count = 0;
+
+	std::vector<Archetype*> 						archetypes;
+	std::unordered_map<ComponentMask, Archetype*> 	archetype_lookup;
+
+	Archetype* get_archetype(ComponentMask mask);
+	Entity create_entity_in(Archetype* ptr_archetype);
+	void allocate_row(Archetype* ptr_archetype, Entity entity, uint32_t& chunk, uint32_t& row);
+	void free_row(Archetype* ptr_archetype, uint32_t chunk, uint32_t row);
+	void move_entity(Entity entity, ComponentMask mask);
+	uint8_t* get_component_data(const EntityRecord& record, uint32_t id);
+};
+
+template<typename... T>
+Entity EntityStore::create_entity(const T&... components)
+{
+	Entity entity = create_entity_in(get_archetype(get_component_mask<T...>()));
+
+	const EntityRecord& record = records[entity.index];
+	(memcpy(get_component_data(record, get_component_id<T>()), &components, sizeof(T)), ...);
+
+	return entity;
+}
+
+template<typename T>
+void EntityStore::add_component(Entity entity, const T& component)
+{
+	if(!is_alive(entity))
+	{
+		throw std::runtime_error("Component added to a dead entity.");
+	}
+
+	uint32_t id = get_component_id<T>();
+
+	move_entity(entity, records[entity.index].ptr_archetype->mask | (ComponentMask(1) << id));
+	memcpy(get_component_data(records[entity.index], id), &component, sizeof(T));
+}
+
+template<typename T>
+void EntityStore::remove_component(Entity entity)
+{
+	if(!is_alive(entity))
+	{
+		throw std::runtime_error("Component removed from a dead entity.");
+	}
+
+	move_entity(entity, records[entity.index].ptr_archetype->mask & ~(ComponentMask(1) << get_component_id<T>()));
+}
+
+template<typename T>
+T* EntityStore::get_component(Entity entity)
+{
+	if(!is_alive(entity))
+	{
+		return nullptr;
+	}
+
+	uint32_t id = get_component_id<T>();
+	const EntityRecord& record = records[entity.index];
+
+	if(!(record.ptr_archetype->mask & (ComponentMask(1) << id)))
+	{
+		return nullptr;
+	}
+
+	return reinterpret_cast<T*>(get_component_data(record, id));
+}
+
+template<typename... T, typename F>
+void EntityStore::for_each(F function)
+{
+	ComponentMask required = get_component_mask<T...>();
+
+	for(Archetype* ptr_archetype : archetypes)
+	{
+		if((ptr_archetype->mask & required) != required)
+		{
+			continue;
+		}
+
+		for(const EntityChunk& chunk : ptr_archetype->chunks)
+		{
+			function(chunk.count, ptr_archetype->template get_array<T>(chunk)...);
+		}
+	}
+}
+
+template<typename... T, typename F>
+void EntityStore::parallel_for_each(JobPool& job_pool, F function)
+{
+	ComponentMask required = get_component_mask<T...>();
+
+	std::vector<std::pair<Archetype*, uint32_t>> matching_chunks;
+
+	for(Archetype* ptr_archetype : archetypes)
+	{
+		if((ptr_archetype->mask & required) == required)
+		{
+			for(uint32_t c = 0; c < ptr_archetype->chunks.size(); c++)
+			{
+				matching_chunks.emplace_back(ptr_archetype, c);
+			}
+		}
+	}
+
+	job_pool.parallel_for(	matching_chunks.size(), 1,
+							[&](size_t first, size_t last)
+							{
+								for(size_t i = first; i < last; i++)
+								{
+									Archetype* ptr_archetype = matching_chunks[i].first;
+									const EntityChunk& chunk = ptr_archetype->chunks[matching_chunks[i].second];
+
+									function(chunk.count, ptr_archetype->template get_array<T>(chunk)...);
+								}
+							});
+}
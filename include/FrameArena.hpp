@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Bump allocator for data that only lives for one frame: allocating is a pointer bump
+//and reset() drops everything at once. Nothing is destructed, only store trivially
+//destructible types in it.
+//Running out takes overflow blocks from the heap for the rest of the frame,
+//the next reset() grows the arena past the high water mark so it doesn't happen again.
+struct FrameArena
+{
+	FrameArena(size_t t_capacity);
+	~FrameArena();
+
+	uint8_t* 				ptr_memory;
+	size_t 					capacity;
+	size_t 					used = 0;
+
+	std::vector<uint8_t*> 	overflow_blocks;
+	size_t 					overflow_used = 0;
+
+	//Most bytes a single frame used, and how many frames did not fit.
+	size_t 					high_water = 0;
+	uint32_t 				overflow_count = 0;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template<typename T>
+	T* allocate_array(size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	//Only once nothing allocated since the last reset is in use anymore.
+	void reset();
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#define FF_FRUSTUM
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FF_FRUSTUM_SSE
+#endif
+
+#include "Matrix4f.hpp"
+
+/* Six planes as (a, b, c, d), a point p is inside when a*x + b*y + c*z + d >= 0 for all of them.
+The normals are normalized, so the plane value is the signed distance.
+Order: left, right, top, bottom, near, far.
+
+Bounds are tested as structure of arrays, one float array per component,
+so four objects go through each plane at once.
+*/
+
+struct Frustum
+{
+	float planes[6][4];
+};
+
+//Gribb/Hartmann plane extraction. Works for any space, planes come out in the space
+//view_proj takes its input from, pass proj * view * model to cull in model space.
+//Assumes Vulkan clip space, depth goes from 0 to w.
+static inline Frustum frustum_from_matrix4f(const Matrix4f& view_proj)
+{
+	Frustum frustum;
+
+	for(int c = 0; c < 4; c++)
+	{
+		float row0 = view_proj.get(c, 0);
+		float row1 = view_proj.get(c, 1);
+		float row2 = view_proj.get(c, 2);
+		float row3 = view_proj.get(c, 3);
+
+		frustum.planes[0][c] = row3 + row0;
+		frustum.planes[1][c] = row3 - row0;
+		frustum.planes[2][c] = row3 + row1;
+		frustum.planes[3][c] = row3 - row1;
+		frustum.planes[4][c] = row2;
+		frustum.planes[5][c] = row3 - row2;
+	}
+
+	for(int p = 0; p < 6; p++)
+	{
+		float length = sqrtf(	frustum.planes[p][0] * frustum.planes[p][0] +
+								frustum.planes[p][1] * frustum.planes[p][1] +
+								frustum.planes[p][2] * frustum.planes[p][2]);
+
+		for(int c = 0; c < 4; c++)
+		{
+			frustum.planes[p][c] /= length;
+		}
+	}
+
+	return frustum;
+}
+
+static inline bool frustum_test_sphere(const Frustum& frustum, float x, float y, float z, float radius)
+{
+	for(int p = 0; p < 6; p++)
+	{
+		const float* plane = frustum.planes[p];
+
+		if(plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Uses the corner furthest along each plane normal.
+static inline bool frustum_test_aabb(	const Frustum& frustum,
+										float min_x, float min_y, float min_z,
+										float max_x, float max_y, float max_z)
+{
+	for(int p = 0; p < 6; p++)
+	{
+		const float* plane = frustum.planes[p];
+
+		float x = plane[0] >= 0.0f ? max_x : min_x;
+		float y = plane[1] >= 0.0f ? max_y : min_y;
+		float z = plane[2] >= 0.0f ? max_z : min_z;
+
+		if(plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Writes 1 to visible[i] for every sphere touching the frustum, 0 otherwise.
+static inline void frustum_test_spheres(const Frustum& frustum,
+										const float* ptr_x, const float* ptr_y, const float* ptr_z,
+										const float* ptr_radius,
+										size_t count,
+										uint8_t* ptr_visible)
+{
+	size_t i = 0;
+
+#ifdef FF_FRUSTUM_SSE
+	__m128 planes[6][4];
+
+	for(int p = 0; p < 6; p++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		}
+	}
+
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(ptr_x + i);
+		__m128 y = _mm_loadu_ps(ptr_y + i);
+		__m128 z = _mm_loadu_ps(ptr_z + i);
+		__m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(ptr_radius + i));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(	_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+											_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		ptr_visible[i] = mask & 1;
+		ptr_visible[i + 1] = (mask >> 1) & 1;
+		ptr_visible[i + 2] = (mask >> 2) & 1;
+		ptr_visible[i + 3] = (mask >> 3) & 1;
+	}
+#endif
+
+	for(; i < count; i++)
+	{
+		ptr_visible[i] = frustum_test_sphere(frustum, ptr_x[i], ptr_y[i], ptr_z[i], ptr_radius[i]);
+	}
+}
+
+//Same as frustum_test_spheres for boxes given by their min and max corners.
+static inline void frustum_test_aabbs(	const Frustum& frustum,
+										const float* ptr_min_x, const float* ptr_min_y, const float* ptr_min_z,
+										const float* ptr_max_x, const float* ptr_max_y, const float* ptr_max_z,
+										size_t count,
+										uint8_t* ptr_visible)
+{
+	size_t i = 0;
+
+#ifdef FF_FRUSTUM_SSE
+	//Center/extent form: the box is outside when dot(n, center) + dot(|n|, extent) + d < 0.
+	__m128 planes[6][4];
+	__m128 abs_planes[6][3];
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+
+	for(int p = 0; p < 6; p++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		}
+
+		for(int c = 0; c < 3; c++)
+		{
+			abs_planes[p][c] = _mm_andnot_ps(sign_mask, planes[p][c]);
+		}
+	}
+
+	for(; i + 4 <= count; i += 4)
+	{
+		__m128 min_x = _mm_loadu_ps(ptr_min_x + i);
+		__m128 min_y = _mm_loadu_ps(ptr_min_y + i);
+		__m128 min_z = _mm_loadu_ps(ptr_min_z + i);
+		__m128 max_x = _mm_loadu_ps(ptr_max_x + i);
+		__m128 max_y = _mm_loadu_ps(ptr_max_y + i);
+		__m128 max_z = _mm_loadu_ps(ptr_max_z + i);
+
+		__m128 center_x = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+		__m128 center_y = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+		__m128 center_z = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+		__m128 extent_x = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+		__m128 extent_y = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+		__m128 extent_z = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for(int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(	_mm_add_ps(_mm_mul_ps(planes[p][0], center_x), _mm_mul_ps(planes[p][1], center_y)),
+											_mm_add_ps(_mm_mul_ps(planes[p][2], center_z), planes[p][3]));
+			__m128 reach = _mm_add_ps(	_mm_add_ps(_mm_mul_ps(abs_planes[p][0], extent_x), _mm_mul_ps(abs_planes[p][1], extent_y)),
+										_mm_mul_ps(abs_planes[p][2], extent_z));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		ptr_visible[i] = mask & 1;
+		ptr_visible[i + 1] = (mask >> 1) & 1;
+		ptr_visible[i + 2] = (mask >> 2) & 1;
+		ptr_visible[i + 3] = (mask >> 3) & 1;
+	}
+#endif
+
+	for(; i < count; i++)
+	{
+		ptr_visible[i] = frustum_test_aabb(	frustum,
+											ptr_min_x[i], ptr_min_y[i], ptr_min_z[i],
+											ptr_max_x[i], ptr_max_y[i], ptr_max_z[i]);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <algorithm>
+
+//Fixed set of worker threads for data parallel loops.
+//parallel_for splits [0, count) into batches, the workers and the calling thread
+//pull batches until none are left, and it only returns once every batch ran.
+//Only one thread may call parallel_for at a time.
+struct JobPool
+{
+	JobPool(uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1);
+	~JobPool();
+
+	//Calls function(first, last) for consecutive ranges of at most batch_size items.
+	void parallel_for(size_t count, size_t batch_size, const std::function<void(size_t, size_t)>& function);
+
+	std::vector<std::thread> 	threads;
+	std::mutex 					job_mutex;
+	std::condition_variable 	job_condition;
+	std::condition_variable 	done_condition;
+
+	//Current job, only changed while no worker is inside it.
+	const std::function<void(size_t, size_t)>* ptr_function = nullptr;
+	size_t 				job_count = 0;
+	size_t 				job_batch_size = 1;
+	size_t 				job_batches = 0;
+	uint32_t 			job_generation = 0;
+
+	std::atomic<size_t> next_batch{0};
+	std::atomic<size_t> finished_batches{0};
+	uint32_t 			active_workers = 0;
+	bool 				stop = false;
+
+	void worker_loop();
+	void run_batches();
+};
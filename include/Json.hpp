@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+//Just enough JSON to read glTF headers. Keeps everything in a simple DOM,
+//objects are kept as key/value lists in file order.
+enum JsonType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+struct JsonValue
+{
+	JsonType type = JSON_NULL;
+
+	bool 		boolean = false;
+	double 		number = 0.0;
+	std::string string;
+
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	//Returns nullptr when this is not an object or the key is missing.
+	const JsonValue* find(const char* key) const;
+
+	size_t size() const { return type == JSON_ARRAY ? array.size() : object.size(); }
+	const JsonValue& operator[](size_t i) const { return array[i]; }
+
+	//Value of a member, or fallback when missing or of the wrong type.
+	double get_number(const char* key, double fallback) const;
+	std::string get_string(const char* key, const std::string& fallback) const;
+};
+
+//Parses a whole JSON document, throws std::runtime_error on malformed input.
+JsonValue json_parse(const char* text, size_t length);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//KTX 2.0 texture container. Only what sprites need: a single 2D image and its mip levels,
+//no supercompression, array layers, cube faces or depth.
+//Both functions throw std::runtime_error on unreadable or unsupported files.
+struct Ktx2Image
+{
+	VkFormat 	format = VK_FORMAT_UNDEFINED;
+	uint32_t 	width = 0;
+	uint32_t 	height = 0;
+
+	//levels[0] is the full size image, every next level half the size of the one before.
+	std::vector<std::vector<uint8_t>> levels;
+};
+
+Ktx2Image load_ktx2(const char* file);
+
+//Writes a basic data format descriptor, only block compressed formats can be saved.
+void save_ktx2(const char* file, const Ktx2Image& image);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+struct SDL_Surface;
+
+//Converts what image decoders hand out to the B, G, R, A bytes textures are uploaded as,
+//straight into the destination so loading needs no intermediate surface.
+//x86 builds pick SSSE3 or AVX2 shuffles at runtime, other targets use plain loops.
+
+//Byte order in memory, whatever the endianness.
+enum PixelLayout
+{
+	PIXEL_LAYOUT_RGB8,
+	PIXEL_LAYOUT_BGR8,
+	PIXEL_LAYOUT_RGBA8,
+	PIXEL_LAYOUT_BGRA8,
+	PIXEL_LAYOUT_BGRX8,		//Alpha byte ignored, written as opaque.
+	PIXEL_LAYOUT_INDEX8
+};
+
+//Converts count pixels. ptr_palette is only read for PIXEL_LAYOUT_INDEX8, 256 BGRA entries.
+void convert_row_to_bgra8(	PixelLayout layout,
+							const uint8_t* ptr_src,
+							uint8_t* ptr_dst,
+							size_t count,
+							const uint8_t* ptr_palette = nullptr);
+
+//False for surface formats the converter doesn't handle, SDL_ConvertSurface has to do those.
+bool can_convert_surface_to_bgra8(const SDL_Surface* surface);
+
+//Writes surface->w * surface->h BGRA pixels to ptr_dst, row after row, no padding.
+//A color key becomes fully transparent, like SDL_ConvertSurface does.
+void convert_surface_to_bgra8(SDL_Surface* surface, uint8_t* ptr_dst);
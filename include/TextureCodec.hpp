@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//Block compressed texture formats, decoded on the CPU when the device can't use them directly.
+//Every format here stores 4x4 pixel blocks, images whose size is not a multiple of 4 still
+//store whole blocks on the edges. Pixels are RGBA8, row after row, no padding.
+
+//8 for BC1, 16 for BC3 and BC7, 0 for anything this codec doesn't handle.
+uint32_t get_block_size(VkFormat format);
+
+//Bytes taken by a width x height image of format, 0 for unhandled formats.
+size_t get_compressed_image_size(VkFormat format, uint32_t width, uint32_t height);
+
+//Like get_compressed_image_size, also handles the 4 byte RGBA8 and BGRA8 formats.
+size_t get_image_size(VkFormat format, uint32_t width, uint32_t height);
+
+//Bytes taken by level_count mip levels packed one after another, level 0 first.
+size_t get_mip_chain_size(VkFormat format, uint32_t width, uint32_t height, uint32_t level_count);
+
+//The uncompressed format the decoded pixels should be uploaded as, keeps sRGB-ness.
+VkFormat get_decoded_format(VkFormat format);
+
+//Each of these writes one 4x4 block to ptr_rgba, row_pitch bytes apart.
+void decode_bc1_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch);
+void decode_bc3_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch);
+void decode_bc7_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch);
+
+//Decodes a whole image of blocks to width * height RGBA8 pixels.
+//Throws std::runtime_error for unhandled formats.
+void decode_compressed_image(	VkFormat format,
+								const uint8_t* ptr_blocks,
+								uint32_t width, uint32_t height,
+								std::vector<uint8_t>& rgba);
+
+//Halves a 4 byte per pixel image with a 2x2 box filter, odd sizes repeat their last row or column.
+//With srgb the first three channels are averaged in linear space so levels don't darken.
+void downsample_image(	const uint8_t* ptr_pixels,
+						uint32_t width, uint32_t height,
+						bool srgb,
+						std::vector<uint8_t>& next_pixels);
+
+//Encoders, only used offline by the converter. Colors are fitted along their principal axis,
+//good enough for sprites and UI, not a match for a dedicated compressor.
+void encode_bc1_block(const uint8_t* ptr_rgba, size_t row_pitch, uint8_t* ptr_block);
+void encode_bc3_block(const uint8_t* ptr_rgba, size_t row_pitch, uint8_t* ptr_block);
+
+//Encodes width * height RGBA8 pixels as BC1 or BC3. Edge blocks repeat the last row and column.
+void encode_compressed_image(	VkFormat format,
+								const uint8_t* ptr_rgba,
+								uint32_t width, uint32_t height,
+								std::vector<uint8_t>& blocks);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Affine3f.hpp"
+
+//Parent/child transforms kept as parallel arrays indexed by node.
+//A node can only be parented to an existing node, so parents always come
+//before their children and update() is a single forward pass.
+//Changing a local transform marks the node dirty, update() recomputes the world
+//transform of dirty nodes and of everything under them, nothing else.
+struct TransformHierarchy
+{
+	static const uint32_t NO_PARENT = UINT32_MAX;
+
+	std::vector<uint32_t> parents;
+	std::vector<Affine3f> local_transforms;
+	std::vector<Affine3f> world_transforms;
+
+	//Local transform changed since the last update.
+	std::vector<uint8_t> dirty;
+
+	//World transform changed by the last update, for whoever mirrors them.
+	std::vector<uint8_t> changed;
+
+	//Lowest dirty node, the pass starts there.
+	uint32_t first_dirty = UINT32_MAX;
+
+	uint32_t add_node(uint32_t parent, const Affine3f& local_transform);
+	void set_local_transform(uint32_t node, const Affine3f& local_transform);
+
+	size_t size() const { return parents.size(); }
+
+	void update();
+};
@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdint>
+#include <cfloat>
 #include <algorithm>
 #include <set>
 #include <fstream>
@@ -28,8 +29,23 @@
 #include "VulkanInstance.hpp"
 #include "VulkanRenderer.hpp"
 #include "VulkanSprite.hpp"
+#include "VulkanDamage.hpp"
+#include "VulkanLayerCache.hpp"
+#include "VulkanOverdraw.hpp"
 #include "VulkanVertex.hpp"
-
+#include "VulkanMeshBuilder.hpp"
+#include "VulkanMeshLoader.hpp"
+#include "VulkanMesh.hpp"
+#include "VulkanTextureStreamer.hpp"
+#include "VulkanTextureCache.hpp"
+#include "TransformHierarchy.hpp"
+#include "VulkanScene.hpp"
+#include "VulkanComponents.hpp"
+
+#include "Frustum.hpp"
+#include "JobPool.hpp"
+#include "FrameArena.hpp"
+#include "EntityStore.hpp"
 #include "Timer.hpp"
 #include "Util.hpp"
 
@@ -44,6 +60,11 @@ public:
 
     const int MAX_FRAMES_IN_FLIGHT = 3;
 
+    //Largest simplification error allowed on screen, in render target pixels, and the fraction
+    //of it a coarser level has to get under before it replaces the current one.
+    const float LOD_PIXEL_ERROR = 1.0f;
+    const float LOD_HYSTERESIS = 0.7f;
+
     #ifdef NDEBUG
     const bool enable_validation_layers = false;
     #else
@@ -70,12 +91,21 @@ public:
     VkImageLayout               renter_target_image_layout;
     std::vector<VkFramebuffer>  render_target_framebuffers;
 
+    //Only live during the render pass, so transient and lazily allocated where supported.
+    std::vector<VkImage>        depth_images;
+    std::vector<VkDeviceMemory> depth_images_memory;
+    std::vector<VkImageView>    depth_image_views;
+    VkFormat                    depth_format;
+
     VkSwapchainKHR        swap_chain;
     std::vector<VkImage>  swap_chain_images;
     VkFormat              swap_chain_image_format;
     VkImageLayout         swap_chain_image_layout;
     VkExtent2D            swap_chain_image_extent;
 
+    //Whether the presentation engine may skip obscured pixels, partial redraws need them all kept.
+    bool                  swap_chain_clipped = true;
+
     std::vector<VkImageView>    swap_chain_image_views;
 
     VkDescriptorSetLayout   descriptor_set_layout;
@@ -86,7 +116,18 @@ public:
 
     VkPipelineLayout    pipeline_layout;
     VkPipeline          graphics_pipeline;
+    VkPipeline          transparent_pipeline;
     VkRenderPass        render_pass;
+
+    //Frustum culling compute pass, writes the indirect draws.
+    VkPipelineLayout    cull_pipeline_layout;
+    VkPipeline          cull_pipeline;
+
+    //Filled in by create_logical_device, GPU culling needs both indirect features
+    //and a compute capable graphics queue.
+    bool        gpu_culling_supported = false;
+    bool        multi_draw_indirect_supported = false;
+    uint32_t    max_draw_indirect_count = 1;
     
     VkCommandPool       command_pool;
 
@@ -94,6 +135,15 @@ public:
     std::vector<VkCommandBuffer> command_buffers_dynamic;
     std::vector<VkCommandBuffer> command_buffers_end;
 
+    //Scene generation and draw order each start buffer was recorded against.
+    std::vector<uint64_t> command_buffers_start_generation;
+    std::vector<uint32_t> command_buffers_start_draw_order;
+
+    //Sprite queue hash each dynamic buffer was recorded against, only kept for full frames
+    //that drew no static layer, those are submitted again as long as the queue is the same.
+    std::vector<uint64_t> command_buffers_dynamic_hash;
+    std::vector<uint8_t>  command_buffers_dynamic_reusable;
+
     std::vector<VkSemaphore> image_available_semaphores;
     std::vector<VkSemaphore> render_start_finished_semaphores;
     std::vector<VkSemaphore> render_dynamic_finished_semaphores;
@@ -102,45 +152,94 @@ public:
     std::vector<VkFence> in_flight_fences;
     std::vector<VkFence> images_in_flight;
 
-    std::vector<Vertex> vertices = 
-    {
-        {{0.5,  0.5, -0.5}, {1.0f, 0.0f, 0.0f}},
-        {{0.5, -0.5, -0.5}, {0.0f, 1.0f, 0.0f}},
-        {{-0.5,-0.5, -0.5}, {0.0f, 0.0f, 1.0f}},
-        {{-0.5, 0.5, -0.5}, {1.0f, 1.0f, 1.0f}},
-        {{0.5,  0.5,  0.5}, {0.0f, 0.0f, 1.0f}},
-        {{0.5, -0.5,  0.5}, {1.0f, 1.0f, 1.0f}},
-        {{-0.5,-0.5,  0.5}, {1.0f, 0.0f, 0.0f}},
-        {{-0.5, 0.5,  0.5}, {0.0f, 1.0f, 0.0f}}
-    };
-
-    std::vector<uint32_t> indices = 
-    {
-        3, 0, 1, //front
-        1, 2, 3, 
-        2, 1, 5, //Bot
-        5, 6, 2,
-        5, 4, 7, //back
-        7, 6, 5,
-        4, 0, 3, //top
-        3, 7, 4,
-        0, 4, 5, //Right
-        5, 1, 0,
-        6, 7, 3, //Left
-        3, 2, 6
-    };
-        
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_buffer_memory;
-
-    VkBuffer index_buffer;
-    VkDeviceMemory index_buffer_memory;
+    //Layout the meshes are built to, the pipeline vertex input follows it.
+    VertexFormat vertex_format = VERTEX_FORMAT_COMPACT;
+    VulkanMeshPool* mesh_pool;
+    VulkanMesh* cube_mesh;
+
+    //Sprite textures loaded on first use, kept within a device memory budget.
+    VulkanTextureStreamer* texture_streamer;
+
+    //Textures shared by file, fonts load theirs through it.
+    VulkanTextureCache* texture_cache;
+
+    //Sprite layers marked static, drawn once into images of their own.
+    VulkanLayerCache* layer_cache;
+
+    TransformHierarchy hierarchy;
+    VulkanScene scene;
+
+    //Resident scene objects as uploaded, grouped by mesh, and one instanced draw per mesh.
+    std::vector<VulkanObjectData> scene_objects;
+    std::vector<VulkanBatch> scene_batches;
+    uint64_t scene_objects_generation = UINT64_MAX;
+
+    //Batches by draw sort key, the generation changes whenever the order does.
+    std::vector<uint32_t> scene_draw_order;
+    std::vector<uint64_t> scene_draw_keys;
+    uint32_t scene_draw_order_generation = 0;
+
+    //Set when the batches changed, the opaque keys are worked out again.
+    bool scene_draw_keys_stale = true;
+
+    //Bounding spheres of scene_objects as separate arrays for the CPU cull,
+    //which is what decides the draws when GPU culling is unavailable.
+    std::vector<float>   scene_sphere_x;
+    std::vector<float>   scene_sphere_y;
+    std::vector<float>   scene_sphere_z;
+    std::vector<float>   scene_sphere_radius;
+    std::vector<uint8_t> scene_objects_visible;
+    std::vector<uint32_t> scene_batches_visible_count;
+
+    JobPool* job_pool;
+
+    //Transient allocations of each frame slot, CPU only. Reset at the end of draw_frames
+    //when its slot is the next one to be built.
+    std::vector<FrameArena*> frame_arenas;
+
+    //Per swapchain image, written only while that image is idle.
+    std::vector<VkBuffer>       object_buffers;
+    std::vector<VkDeviceMemory> object_buffers_memory;
+    std::vector<void*>          object_buffers_mapped;
+    std::vector<VkBuffer>       indirect_buffers;
+    std::vector<VkDeviceMemory> indirect_buffers_memory;
+    std::vector<VkBuffer>       batch_buffers;
+    std::vector<VkDeviceMemory> batch_buffers_memory;
+    std::vector<void*>          batch_buffers_mapped;
+    std::vector<VkBuffer>       instance_buffers;
+    std::vector<VkDeviceMemory> instance_buffers_memory;
+    std::vector<void*>          instance_buffers_mapped;
+    std::vector<uint32_t>       object_buffers_capacity;
+
+    //Slots in scene_objects moved since each object buffer was last written, and the slot
+    //of every scene object, UINT32_MAX for ones not gathered.
+    std::vector<std::vector<uint32_t>> object_buffers_moved;
+    std::vector<uint32_t>              scene_object_slots;
 
     std::vector<VkBuffer> uniform_buffers;
     std::vector<VkDeviceMemory> uniform_buffers_memory;
 
     VulkanFont* tiny_font;
     VulkanSpriteQueue sprite_queue;
+    VulkanTextRunCache text_runs;
+
+    //Frames without 3D only redraw and upscale what their sprites changed. That needs the
+    //swapchain to be a whole multiple of the render target, in a format the black clear
+    //buffer can be copied to.
+    VulkanDamageTracker damage_tracker;
+    bool                partial_redraw_supported = false;
+    VkBuffer            damage_clear_buffer;
+    VkDeviceMemory      damage_clear_buffer_memory;
+
+    //Per layer blit counters, and the heatmap shown instead of the sprites by
+    //set_overdraw_heatmap(), copied to the render target from a mapped buffer per image.
+    VulkanOverdraw              overdraw;
+    std::vector<VkBuffer>       heatmap_buffers;
+    std::vector<VkDeviceMemory> heatmap_buffers_memory;
+    std::vector<void*>          heatmap_buffers_mapped;
+
+    //Game objects, their sprites and meshes are picked up every frame.
+    EntityStore entities;
 
     size_t current_frame = 0;
 
@@ -179,15 +278,23 @@ public:
     void create_render_targets();
     void create_render_target_image_views();
 
+    VkFormat find_depth_format();
+    void create_depth_targets();
+
 	void create_render_pass();
 
 	VkShaderModule create_shader_module(const std::vector<char>& code);
 
 	void create_graphics_pipeline();
+	void create_cull_pipeline();
 
 	void create_framebuffers(); 
 
     void create_texture_sampler();
+    bool is_texture_format_supported(VkFormat format);
+    void create_texture_streamer();
+    void create_damage_tracking();
+    void set_overdraw_heatmap(bool enabled);
 
     void cpu_draw_frames(uint32_t current_framebuffer);
     void draw_frames();
@@ -197,11 +304,27 @@ public:
     //COMMAND
     void update_uniform_buffer(uint32_t current_image);
 
-    //Vertex Buffer
-    void create_vertex_buffer();
+    //Meshes
+    void create_mesh_pool();
+
+    //Scene objects
+    uint64_t get_scene_generation();
+    void create_object_buffers();
+    void create_object_buffer(uint32_t current_image, uint32_t capacity);
+    void destroy_object_buffer(uint32_t current_image);
+    void write_object_descriptors(uint32_t current_image);
+    void update_object_buffer(uint32_t current_image);
+    void read_scene_lods(uint32_t current_image);
+    void patch_moved_objects(uint32_t current_image);
+    void cull_scene_objects(const Matrix4f& view_proj);
+    void write_visible_instances(uint32_t current_image);
+    void select_scene_lods(const Matrix4f& view_proj, float pixels_per_unit);
+    void sort_scene_batches(const Matrix4f& view_proj);
+
+    //Entities
+    void queue_entity_sprites(EntityStore& entity_store);
+    void update_entity_meshes(EntityStore& entity_store);
 
-    //Index Buffer
-    void create_index_buffer();
     void create_uniform_buffers();
 
     //Descriptor Set Layout
@@ -214,7 +337,17 @@ public:
 	void create_render_command_buffers(); 
 
     void start_render_cmd(uint32_t current_framebuffer);
-    VkCommandBuffer dynamic_render_cmd(uint32_t current_framebuffer);
+    void dynamic_render_cmd(uint32_t current_framebuffer);
+    void damage_render_cmd(uint32_t current_framebuffer, const VulkanDamage& damage);
+
+    //Records the sprites of sorted keys into target moved by -origin, once for every clip rect.
+    //The target has to be a transfer destination.
+    void record_sprite_cmds(VkCommandBuffer command_buffer,
+                            VkImage target, VkFormat target_format,
+                            const VulkanSprite* ptr_sprites,
+                            const uint64_t* ptr_keys, uint32_t key_count,
+                            VkOffset2D origin,
+                            const VkRect2D* ptr_clips, uint32_t clip_count);
     void end_render_cmd(uint32_t current_framebuffer);
 
 	VkCommandBuffer begin_one_time_commands();
@@ -223,17 +356,28 @@ public:
     void exec_copy_buffer_cmd(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
 
 
+    //Both transition mip levels 0 to mip_levels - 1.
     void transition_image_layout_cmd(   VkCommandBuffer command_buffer,
                                         VkImage image, VkFormat format, 
                                         VkImageLayout old_layout,
-                                        VkImageLayout new_layout);
+                                        VkImageLayout new_layout,
+                                        uint32_t mip_levels = 1);
 
     void exec_transition_image_layout_cmd(  VkImage image, VkFormat format, 
                                             VkImageLayout old_layout,
-                                            VkImageLayout new_layout);
+                                            VkImageLayout new_layout,
+                                            uint32_t mip_levels = 1);
+
+    void exec_generate_mipmaps_cmd( VkImage image, VkFormat format,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t mip_levels);
 
     void exec_copy_buffer_to_image_cmd( VkBuffer buffer, VkImage image, 
                                         uint32_t width, uint32_t height);
+
+    //One command buffer for all regions, used to upload every mip level at once.
+    void exec_copy_buffer_to_image_cmd( VkBuffer buffer, VkImage image, 
+                                        const std::vector<VkBufferImageCopy>& regions);
     
     //Buffer
     void create_buffer( VkDeviceSize size, VkBufferUsageFlags usage,
@@ -244,10 +388,12 @@ public:
     void create_vulkan_image(   uint32_t width, uint32_t height, 
                                 VkFormat format, 
                                 VkImageUsageFlags usage, 
-                                VkImage& image, VkDeviceMemory& memory);
+                                VkImage& image, VkDeviceMemory& memory,
+                                uint32_t mip_levels = 1);
 
     VkImageView create_image_view(  VkImage image, 
-                                    VkFormat format);
+                                    VkFormat format,
+                                    uint32_t mip_levels = 1);
 
     //Sync
     void create_semaphore(VkSemaphore& semaphore);
@@ -272,6 +418,12 @@ public:
                     const VkOffset2D& offset,
                     uint32_t layer);
 
+    //Draws the placeholder over destination until the texture is resident.
+    void draw_streamed_sprite(  VulkanStreamedTexture* ptr_streamed,
+                                const VkRect2D& source,
+                                const VkRect2D& destination,
+                                uint32_t layer);
+
     //Misc
     uint32_t find_memory_type(  VkPhysicalDevice device,
                                 uint32_t type_filter, 
@@ -0,0 +1,24 @@
+#pragma once
+
+//Entity components the renderer reads straight out of an EntityStore.
+//(See Vulkan::queue_entity_sprites and Vulkan::update_entity_meshes)
+
+//Blits source from ptr_texture to destination on layer every frame.
+struct SpriteComponent
+{
+	VulkanTexture* 	ptr_texture;
+	VkRect2D 		source;
+	VkRect2D 		destination;
+	uint32_t 		layer;
+};
+
+struct TransformComponent
+{
+	Affine3f transform;
+};
+
+//Moves scene_object along with the entity TransformComponent.
+struct MeshComponent
+{
+	uint32_t scene_object;
+};
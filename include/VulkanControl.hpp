@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Matrix4f.hpp"
+#include "Affine3f.hpp"
 
 //Remember to check for aligment issues.
 /*
@@ -13,9 +14,19 @@
 	use alignas(bytes) to align things properly
 */
 
+//model is affine, so it only takes three vec4 rows on the shader side.
 struct UniformBufferObject
 {
-	Matrix4f model;
+	Affine3f model;
 	Matrix4f view;
 	Matrix4f proj;
 };
+
+//Push constants of shaders/cull.comp.
+struct CullConstants
+{
+	uint32_t 	object_count;
+	float 		half_target_height;	//Turns clip space into render target pixels with the projection.
+	float 		lod_pixel_error;
+	float 		lod_hysteresis;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+struct VulkanSpriteQueue;
+
+//Past this many rects new ones get merged into the closest, redrawing a few extra pixels
+//is cheaper than more commands.
+static const uint32_t DAMAGE_MAX_RECTS = 16;
+
+//Frames of damage remembered, an image not drawn for longer is redrawn whole.
+static const uint32_t DAMAGE_HISTORY = 8;
+
+//Part of the render target that has to be redrawn. The rects never overlap,
+//so every pixel is cleared and drawn once.
+struct VulkanDamage
+{
+	VkRect2D 	rects[DAMAGE_MAX_RECTS];
+	uint32_t 	count = 0;
+	bool 		full = false;
+
+	void add(const VkRect2D& rect);
+	void add(const VulkanDamage& damage);
+	void clear();
+
+	//Whether rect is partly but not wholly in the damage.
+	bool cuts(const VkRect2D& rect) const;
+};
+
+//A drawn sprite as the diff sees it, the hash covers everything deciding its pixels,
+//including the sprite drawn right before it in the same layer and texture.
+struct VulkanDamageSprite
+{
+	uint64_t 	hash;
+	VkRect2D 	rect;
+	bool 		scaled;
+};
+
+//Diffs the sprite list of every frame against the previous one, sprites that appeared,
+//went away or changed damage the rect they cover. Swapchain images and their render targets
+//keep what was last drawn to them, so an image only needs the damage of the frames since
+//then, as many as its age.
+//Scaled sprites don't sample the same when cut, so damage cutting one grows over all of it.
+struct VulkanDamageTracker
+{
+	VkExtent2D 	extent = {0, 0};
+
+	//Sprites of the last frame added sorted by hash, and room for the next one.
+	std::vector<VulkanDamageSprite> sprites;
+	std::vector<VulkanDamageSprite> next_sprites;
+
+	//Damage of the last DAMAGE_HISTORY frames, by frame modulo DAMAGE_HISTORY.
+	VulkanDamage 	history[DAMAGE_HISTORY];
+	uint64_t 		frame = 0;
+
+	//Frame each swapchain image was last drawn in, 0 for never.
+	std::vector<uint64_t> image_frames;
+
+	void init(VkExtent2D t_extent, uint32_t image_count);
+
+	//Takes the sorted queue of a new frame. full damages the whole target,
+	//for changes the sprites don't show like the 3D pass.
+	void add_frame(const VulkanSpriteQueue& queue, bool full);
+
+	//What image has to redraw to show the current frame, the image counts as drawn after.
+	void take_image_damage(uint32_t image, VulkanDamage& damage);
+
+	//Every image gets redrawn whole next time.
+	void invalidate();
+};
@@ -1,14 +1,62 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "VulkanTexture.hpp"
+#include "VulkanSprite.hpp"
+
+//Fixed size glyphs for characters 0x20 to 0x7f, 0x20 per atlas row.
+static const uint32_t FONT_GLYPH_COUNT = 0x60;
 
 struct VulkanFont
 {
-	VulkanTexture texture;
+	Vulkan* vulkan_instance;
+
+	//Shared through the texture cache.
+	VulkanTexture* ptr_texture;
 	VkExtent2D dimensions;
 
+	//Atlas rect of every glyph, worked out once.
+	VkRect2D glyph_rects[FONT_GLYPH_COUNT];
+
 	VulkanFont(	Vulkan* t_vulkan_instance,
 				VkExtent2D t_dimensions,
 				const char * t_file_location);
-};
\ No newline at end of file
+	~VulkanFont();
+
+	//Characters without a glyph get the space.
+	const VkRect2D& get_glyph_rect(char content) const;
+};
+
+//Strings already laid out as sprites from the origin, keyed by font and text, so text drawn
+//every frame is queued as one prebuilt run wherever it moves to.
+//Runs not drawn for TEXT_RUN_MAX_AGE frames are dropped.
+struct VulkanTextRunCache
+{
+	static const uint32_t TEXT_RUN_MAX_AGE = 120;
+
+	struct Run
+	{
+		//A font created where a destroyed one was gets told apart by its texture.
+		const VulkanFont* 			ptr_font;
+		const VulkanTexture* 		ptr_texture;
+		std::string 				text;
+		std::vector<VulkanSprite> 	sprites;
+		uint64_t 					last_used_frame;
+	};
+
+	//Keyed by a hash of everything in the key, colliding runs replace each other.
+	std::unordered_map<uint64_t, Run> runs;
+
+	uint64_t frame = 0;
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+	//Found without allocating once the run exists. Queue it with the offset to draw it at.
+	const std::vector<VulkanSprite>& get_run(const VulkanFont& font, const char* content);
+
+	//Call once per frame.
+	void update();
+};
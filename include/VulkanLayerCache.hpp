@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+class Vulkan;
+struct VulkanTexture;
+struct VulkanSpriteQueue;
+
+//Largest side of a layer image, layers spreading further are drawn sprite by sprite.
+static const uint32_t LAYER_CACHE_MAX_SIZE = 4096;
+
+struct VulkanStaticLayer
+{
+	VkOffset2D 		scroll = {0, 0};
+
+	//Set to keep the sprites the layer has without queueing them again every frame.
+	bool 			unchanged = false;
+
+	//Holds the sprites hashed to hash when drawn is set, bounds is the layer space rect
+	//they cover. image_defined once the image has been drawn at all.
+	VulkanTexture* 	ptr_texture = nullptr;
+	VkRect2D 		bounds = {{0, 0}, {0, 0}};
+	uint64_t 		hash = 0;
+	bool 			drawn = false;
+	bool 			image_defined = false;
+
+	//Disjoint layer space rects covering exactly what the sprites in the image cover,
+	//each put on screen as a sprite of its own.
+	std::vector<VkRect2D> 		regions;
+
+	//Sprites of the layer, keys sorted. sprite_bounds is the rect they cover, empty when
+	//they cover nothing.
+	std::vector<VulkanSprite> 	sprites;
+	std::vector<uint64_t> 		keys;
+	uint64_t 					sprite_hash = 0;
+	VkRect2D 					sprite_bounds = {{0, 0}, {0, 0}};
+
+	//Set when the image has to be drawn again this frame.
+	bool 			redraw = false;
+};
+
+//Static layers are drawn once into an image of their own, which every frame then puts on
+//screen as a few sprites covering just the rects of its sprites, so lower layers show through
+//the gaps. The image is only drawn again when the sprites of the layer change, sprites are
+//queued in layer space and scroll moves the layer without drawing it again.
+//Blits don't blend, so a static layer covers everything under its sprites: it's meant for
+//backgrounds.
+struct VulkanLayerCache
+{
+	VulkanLayerCache(Vulkan* vulkan);
+	~VulkanLayerCache();
+
+	Vulkan* 	vulkan_instance;
+
+	//Counts replace_layers() calls, retired images remember the one they were replaced in.
+	uint64_t 	frame = 0;
+
+	uint32_t 	redraws = 0;
+
+	std::unordered_map<uint32_t, VulkanStaticLayer> 			layers;
+	std::vector<std::pair<VulkanTexture*, uint64_t>> 			retired_textures;
+
+	void set_static(uint32_t layer, bool is_static);
+	void set_scroll(uint32_t layer, VkOffset2D scroll);
+
+	//While set the layer keeps drawing the sprites it had the last frame it was not,
+	//without them being queued, hashed or sorted again. Sprites queued on it meanwhile
+	//are dropped.
+	void set_unchanged(uint32_t layer, bool unchanged);
+
+	//Swaps the sprites of static layers in the unsorted queue for their images.
+	//Call once per frame after waiting on the frame fence.
+	void replace_layers(VulkanSpriteQueue& queue);
+
+	//Draws the layers replace_layers() found changed, before anything reads them.
+	void record_redraws(VkCommandBuffer command_buffer);
+	bool has_redraws() const;
+
+	void retire(VulkanTexture* ptr_texture);
+
+	//Sorts and hashes the sprites of a layer, drawing its image again when they changed.
+	void update_layer(uint32_t layer, VulkanStaticLayer& static_layer, VulkanSpriteQueue& queue);
+	//Puts the part of a layer on screen back in the queue.
+	void queue_layer(uint32_t layer, const VulkanStaticLayer& static_layer, VulkanSpriteQueue& queue);
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Vulkan;
+
+enum VulkanMeshState
+{
+	MESH_LOADING,	//Queued on or being parsed by the loader thread.
+	MESH_UPLOADING,	//Has its arena ranges, bytes are still being copied.
+	MESH_RESIDENT,	//Ready to draw.
+	MESH_FAILED		//Could not be read or did not fit, never drawn.
+};
+
+//A mesh living inside a VulkanMeshPool. Draw it with the pool buffers bound:
+//vkCmdDrawIndexed(index_count, 1, first_index, vertex_offset, 0) with the index
+//buffer bound at offset 0 as index_type. Coarser levels of detail are drawn the same
+//way with their own index range, first_index and index_count are level 0.
+//file is set before the mesh is queued and only read after, the loader thread reads it while
+//parsing. Everything else is only touched by the main thread, the loader hands its results
+//over through the pool.
+struct VulkanMesh
+{
+	std::string 	file;
+	VulkanMeshState state = MESH_LOADING;
+
+	VkIndexType 	index_type = VK_INDEX_TYPE_UINT32;
+	uint32_t 		first_index = 0;
+	uint32_t 		index_count = 0;
+	int32_t 		vertex_offset = 0;
+	uint32_t 		vertex_count = 0;
+
+	Affine3f 		dequantize = a3f_identity();
+
+	Vector3f 		bounds_min = v3f_zero();
+	Vector3f 		bounds_max = v3f_zero();
+
+	//Index ranges are absolute, errors are in mesh space.
+	uint32_t 		lod_count = 1;
+	MeshLod 		lods[MAX_MESH_LODS];
+};
+
+//Every mesh shares one vertex buffer and one index buffer, handed out as a bump arena,
+//so drawing any number of meshes needs a single bind.
+//Files are parsed and optimized on a loader thread, update() then streams the results
+//into the arena through a persistent staging buffer, at most upload_budget bytes per call,
+//without ever waiting on the GPU.
+struct VulkanMeshPool
+{
+	VulkanMeshPool(	Vulkan* vulkan,
+					VertexFormat t_vertex_format,
+					uint32_t t_max_vertices,
+					VkDeviceSize t_max_index_bytes,
+					VkDeviceSize t_upload_budget);
+	~VulkanMeshPool();
+
+	Vulkan* 		vulkan_instance;
+
+	VertexFormat 	vertex_format;
+	uint32_t 		vertex_stride;
+
+	VkBuffer 		vertex_buffer;
+	VkDeviceMemory 	vertex_buffer_memory;
+	uint32_t 		max_vertices;
+	uint32_t 		used_vertices = 0;
+
+	//16 and 32 bit indices share the buffer, each range is aligned to its index size.
+	VkBuffer 		index_buffer;
+	VkDeviceMemory 	index_buffer_memory;
+	VkDeviceSize 	max_index_bytes;
+	VkDeviceSize 	used_index_bytes = 0;
+
+	VkBuffer 		staging_buffer;
+	VkDeviceMemory 	staging_buffer_memory;
+	uint8_t* 		ptr_staging;
+	VkDeviceSize 	upload_budget;
+
+	VkCommandBuffer upload_command_buffer;
+	VkFence 		upload_fence;
+	bool 			upload_pending = false;
+
+	//Bumped every time a mesh becomes resident, recorded draws go stale when it changes.
+	uint32_t 		generation = 0;
+
+	//Every mesh ever requested, in request order. Owned by the pool.
+	std::vector<VulkanMesh*> meshes;
+
+	//Starts loading a file in the background. The mesh stays valid for the pool lifetime,
+	//check its state before drawing it.
+	VulkanMesh* load_mesh(const char* file);
+
+	//Call once per frame from the thread that submits to the graphics queue.
+	void update();
+
+	//True once nothing is left to load or upload.
+	bool is_idle();
+
+	struct LoadedMesh
+	{
+		VulkanMesh* ptr_mesh;
+		MeshData 	data;
+		std::string error_msg;
+	};
+
+	struct PendingUpload
+	{
+		VulkanMesh* ptr_mesh;
+		MeshData 	data;
+		VkDeviceSize vertex_bytes_done = 0;
+		VkDeviceSize index_bytes_done = 0;
+	};
+
+	std::deque<PendingUpload> 	upload_queue;
+	std::vector<VulkanMesh*> 	uploads_in_flight;
+
+	std::thread 			loader_thread;
+	std::mutex 				loader_mutex;
+	std::condition_variable loader_condition;
+	std::deque<VulkanMesh*> load_queue;
+	std::deque<LoadedMesh> 	ready_queue;
+
+	//Swapped with ready_queue every update, a fresh deque would allocate each time.
+	std::deque<LoadedMesh> 	loaded_meshes;
+	bool 					stop_loader = false;
+
+	void loader_loop();
+	void allocate(LoadedMesh& loaded);
+	void submit_uploads();
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "Affine3f.hpp"
+
+//Most levels of detail a mesh can have, level 0 being the full mesh.
+static const uint32_t MAX_MESH_LODS = 4;
+
+//One level of detail: a range of index_data, indexing the same vertices as every other level.
+//error is how far, in mesh space, the simplified surface may be from the full one.
+struct MeshLod
+{
+	uint32_t 	first_index = 0;
+	uint32_t 	index_count = 0;
+	float 		error = 0.0f;
+};
+
+//A mesh converted to the layout it will have on the GPU.
+//vertex_data holds vertex_count vertices of vertex_format,
+//index_data holds index_count indices of index_type, every level of detail one after another.
+//dequantize maps quantized positions back into mesh space, it has to be
+//applied before the model matrix. It is the identity for VERTEX_FORMAT_FULL.
+struct MeshData
+{
+	VertexFormat 	vertex_format = VERTEX_FORMAT_FULL;
+	VkIndexType 	index_type = VK_INDEX_TYPE_UINT32;
+
+	uint32_t 		vertex_count = 0;
+	uint32_t 		index_count = 0;
+
+	std::vector<uint8_t> vertex_data;
+	std::vector<uint8_t> index_data;
+
+	Affine3f 		dequantize = a3f_identity();
+
+	Vector3f 		bounds_min = v3f_zero();
+	Vector3f 		bounds_max = v3f_zero();
+
+	uint32_t 		lod_count = 1;
+	MeshLod 		lods[MAX_MESH_LODS];
+};
+
+//Reorders triangles so that vertices are reused while still in the post transform cache.
+//(Tom Forsyth, Linear-Speed Vertex Cache Optimisation)
+void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+//Reorders clusters of an already cache optimized index list so that outward facing,
+//outer clusters come first, letting early depth tests reject what is behind them.
+//threshold is how much worse than the input ACMR the result is allowed to be.
+//(Sander, Nehab, Barczak, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw)
+void optimize_overdraw(	std::vector<uint32_t>& indices,
+						const std::vector<Vertex>& vertices,
+						float threshold = 1.05f);
+
+//Reorders vertices by first use so fetches walk memory linearly, remaps the indices.
+//Vertices not referenced by any index are dropped.
+void optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+//Average transformed vertices per triangle for a FIFO cache of cache_size entries.
+//1.0 is about as good as a regular mesh gets, 3.0 is no reuse at all.
+float get_average_cache_miss_ratio(	const std::vector<uint32_t>& indices,
+									uint32_t vertex_count,
+									uint32_t cache_size = 16);
+
+//Collapses edges in order of quadric error until at most target_index_count indices are left
+//or nothing can collapse without flipping a triangle. Vertices are never moved or added, so
+//the result still indexes vertices. Border edges, attribute seams included, stay in place.
+//Returns the largest error of any collapse as a mesh space distance.
+//(Garland, Heckbert, Surface Simplification Using Quadric Error Metrics)
+float simplify_mesh(const std::vector<Vertex>& vertices,
+					std::vector<uint32_t>& indices,
+					uint32_t target_index_count);
+
+//Builds the GPU layout of a mesh, optimizing triangle and vertex order first if asked.
+//Up to lod_count levels of detail are generated, each with about half the triangles of
+//the one before, stopping early once simplification stops paying off.
+//Picks 16 bit indices whenever every index fits.
+MeshData build_mesh(std::vector<Vertex> vertices,
+					std::vector<uint32_t> indices,
+					VertexFormat vertex_format,
+					bool optimize = true,
+					uint32_t lod_count = 1);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+//Mesh file readers, they only produce plain Vertex/index lists and can run on any thread.
+//Everything throws std::runtime_error on unreadable or unsupported files.
+
+//Wavefront OBJ. Faces are triangulated as fans, "v x y z r g b" vertex colors are read,
+//normals are ignored since Vertex has none.
+void load_obj_mesh(	const char* file,
+					std::vector<Vertex>& vertices,
+					std::vector<uint32_t>& indices);
+
+//Binary glTF 2.0 (.glb). Every triangle primitive of every mesh is merged into one list,
+//node transforms are ignored. Reads POSITION, COLOR_0 and TEXCOORD_0.
+void load_glb_mesh(	const char* file,
+					std::vector<Vertex>& vertices,
+					std::vector<uint32_t>& indices);
+
+//Picks the reader from the file extension.
+void load_mesh_file(const char* file,
+					std::vector<Vertex>& vertices,
+					std::vector<uint32_t>& indices);
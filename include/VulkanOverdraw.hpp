@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+struct VulkanSpriteQueue;
+
+//From this many writes on a pixel shows the hottest color of the heatmap.
+static const uint32_t OVERDRAW_HEATMAP_LEVELS = 8;
+
+//What the sprites of one layer cost the last frame. Pixels are render target pixels written,
+//bytes are texture bytes read plus render target bytes written, read from the mip level
+//the blit uses, and only the part of the sprite on the target.
+struct VulkanLayerStats
+{
+	uint32_t 	layer = 0;
+	uint32_t 	sprite_count = 0;
+	uint64_t 	pixels_touched = 0;
+	uint64_t 	bytes_moved = 0;
+};
+
+//Counts where the sprite blits of every frame go, for finding overdraw in content.
+//Sprites culled as hidden are not counted, they cost nothing. Static layers count the
+//sprites putting their image on screen, not the redraws of their images.
+struct VulkanOverdraw
+{
+	//Set to count layers every frame, the heatmap counts them too.
+	bool 		enabled = false;
+	bool 		heatmap = false;
+
+	//Layers of the last counted frame with any sprite on the target, lowest first.
+	std::vector<VulkanLayerStats> layer_stats;
+
+	//Sprite writes of every render target pixel, row after row, while heatmap is set.
+	VkExtent2D 				extent = {0, 0};
+	std::vector<uint16_t> 	write_counts;
+
+	//Takes the sorted queue as it is going to be drawn on a target of extent and format.
+	void add_frame(const VulkanSpriteQueue& queue, VkExtent2D t_extent, VkFormat target_format);
+
+	//nullptr when layer drew nothing last frame.
+	const VulkanLayerStats* find_layer(uint32_t layer) const;
+
+	//Writes write_counts as 4 byte pixels colored from black for none up through blue, green,
+	//yellow and red to white, swapped to BGRA order with bgra.
+	void write_heatmap(uint32_t* ptr_pixels, bool bgra) const;
+};
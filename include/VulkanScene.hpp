@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+//Per object data read by shaders/cull.comp and shaders/vert.vert,
+//matches the std430 Object struct in shaders/objects.glsl.
+struct VulkanObjectData
+{
+	Affine3f model;				//Object transform with the mesh dequantize folded in.
+	Vector4f bounding_sphere;	//xyz center, w radius, before ubo.model.
+	uint32_t batch;				//Draw batch drawing this object.
+	float 	 opacity;
+	uint32_t object;			//Index in VulkanScene.
+	uint32_t padding;
+};
+
+static_assert(sizeof(VulkanObjectData) == 80, "VulkanObjectData must match the std430 Object layout.");
+
+//Indirect draw of a batch with what the cull shader needs to pick levels of detail,
+//matches the std430 DrawCommand struct in shaders/cull.comp.
+struct VulkanDrawCommand
+{
+	VkDrawIndexedIndirectCommand draw;
+	uint32_t 	lod;
+	uint32_t 	lod_count;
+	float 		lod_error;
+};
+
+static_assert(sizeof(VulkanDrawCommand) == 32, "VulkanDrawCommand must match the std430 DrawCommand layout.");
+
+//One instanced draw of one level of detail of a mesh. The opaque objects using that mesh form
+//a group, every transparent object is a group of its own, with one batch per level of detail,
+//and each object is drawn by the batch of the level it currently has.
+struct VulkanBatch
+{
+	VkDrawIndexedIndirectCommand draw;	//firstInstance starts the instance slots of the batch.
+	VkIndexType 				 index_type;
+	bool 						 transparent;
+
+	uint32_t 	first_object;		//The group, every batch of it has room for all of its objects.
+	uint32_t 	object_count;
+	uint32_t 	lod;
+	uint32_t 	lod_count;
+	float 		lod_error;			//Mesh LOD error over the mesh bounding radius.
+};
+
+//64 bit draw order key, smaller keys draw first. Bit 63 puts transparent batches after
+//every opaque one, the next 32 bits hold the view depth, front to back for opaque batches
+//so early depth tests reject what is hidden and back to front for transparent ones so they
+//blend correctly, the low 31 bits are the batch keeping the order stable.
+static inline uint64_t get_draw_sort_key(bool transparent, float depth, uint32_t batch)
+{
+	//Non negative floats sort the same as their bit patterns.
+	float clamped = depth > 0.0f ? depth : 0.0f;
+	uint32_t depth_bits;
+	memcpy(&depth_bits, &clamped, sizeof(float));
+
+	if(transparent)
+	{
+		depth_bits = ~depth_bits;
+	}
+
+	return (uint64_t(transparent) << 63) | (uint64_t(depth_bits) << 31) | (batch & 0x7FFFFFFF);
+}
+
+//Flat list of drawable objects, kept as parallel arrays indexed by object id.
+//Anything that changes bumps generation, which is what the renderer watches, except for
+//objects moved with move_object(), which the renderer patches in place.
+struct VulkanScene
+{
+	static const uint32_t NO_NODE = UINT32_MAX;
+
+	std::vector<VulkanMesh*> 	meshes;
+	std::vector<Affine3f> 		transforms;
+
+	//Hierarchy node driving each object transform, NO_NODE when set by hand.
+	std::vector<uint32_t> 		nodes;
+
+	//Objects below 1 are drawn blended after every opaque object.
+	std::vector<float> 			opacities;
+
+	//Level of detail each object was last drawn with, kept up to date by the renderer
+	//so a regather does not restart it. Changing it does not bump generation.
+	std::vector<uint8_t> 		lods;
+
+	//Objects moved since the renderer last took them, an object can be in it more than once.
+	std::vector<uint32_t> 		moved_objects;
+
+	uint32_t generation = 0;
+
+	uint32_t add_object(VulkanMesh* ptr_mesh, const Affine3f& transform);
+	void set_transform(uint32_t object, const Affine3f& transform);
+
+	//Like set_transform for objects that move every frame, nothing is gathered again.
+	void move_object(uint32_t object, const Affine3f& transform);
+
+	//Brings the transform and bounding sphere of data, gathered from object, up to date.
+	void update_object_data(uint32_t object, VulkanObjectData& data) const;
+
+	void set_opacity(uint32_t object, float opacity);
+
+	//Takes the current world transform of node, later ones come through update_transforms().
+	void attach_to_node(uint32_t object, uint32_t node, const TransformHierarchy& hierarchy);
+
+	//Picks up the world transforms that changed in the last hierarchy update.
+	void update_transforms(const TransformHierarchy& hierarchy);
+
+	size_t size() const { return meshes.size(); }
+
+	//Fills objects with every object whose mesh is resident, opaque ones grouped by mesh,
+	//and batches with one instanced draw per level of detail of each group. Objects are
+	//put in the batch of their current level. Returns the instance slots the batches need.
+	uint32_t gather_objects(std::vector<VulkanObjectData>& objects,
+							std::vector<VulkanBatch>& batches) const;
+};
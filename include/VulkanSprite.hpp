@@ -1,5 +1,7 @@
 #pragma once
 
+#include "FrameArena.hpp"
+
 //A sprite is a texture that is going to be rendered on screen.
 //The texture can be a full image or can be a sprite atlas.
 //Source is the source rectangle on the texture to be displayed at destination.
@@ -18,11 +20,61 @@ struct VulkanSprite
 					bool t_pixel_perfect=true);
 };
 
+//Sort key, high bits first: layer, filter, texture id, queue order.
+static const uint32_t SPRITE_KEY_LAYER_BITS = 16;
+static const uint32_t SPRITE_KEY_TEXTURE_BITS = 23;
+static const uint32_t SPRITE_KEY_INDEX_BITS = 24;
+static const uint64_t SPRITE_KEY_INDEX_MASK = (uint64_t(1) << SPRITE_KEY_INDEX_BITS) - 1;
+
+//Hash of everything deciding the pixels a sprite writes: its key without the queue index,
+//texture and both rects. Chains from hash, so a list of sprites can be hashed in order.
+static const uint64_t SPRITE_HASH_SEED = 0xcbf29ce484222325;
+
+uint64_t hash_sprite(const VulkanSprite& sprite, uint64_t key, uint64_t hash = SPRITE_HASH_SEED);
+
+//Shrunk sprites read the mip level closest to their size instead of skipping texels.
+uint32_t get_sprite_mip_level(const VulkanSprite& sprite);
+
+//Side in pixels of the cells cull_hidden() tracks coverage in.
+static const uint32_t SPRITE_CULL_CELL_SIZE = 8;
+
+//Every sprite of a frame in one flat array taken from the frame arena, so queueing never
+//touches the heap. A full array moves to one twice its size, the old one is left to the reset.
+//Each sprite gets a 64 bit key, sort() radix sorts them so sprites are drawn layer by layer,
+//grouped by texture within a layer, in queue order within a texture.
+//Sprites that have to overlap in a given order therefore belong on different layers.
 struct VulkanSpriteQueue
 {
-	int queued_layers = 0;
-	std::vector<std::vector<VulkanSprite*>> queue;
+	VulkanSprite* 	ptr_sprites = nullptr;
+	uint64_t* 		ptr_keys = nullptr;
+	uint32_t 		count = 0;
+	uint32_t 		capacity = 0;
 
-	void queue_sprite(VulkanSprite* ptr_sprite, uint32_t layer);
+	//Every sprite queued this frame hashed in queue order, which decides the sorted order too.
+	//Sprites taken back off the queue stay in it.
+	uint64_t 		hash = SPRITE_HASH_SEED;
+
+	//Arena of the next frame to be drawn, reset and swapped in at the end of draw_frames
+	//right after clear_queue(), so sprites queued between frames land in it.
+	FrameArena* 	ptr_arena = nullptr;
+
+	//layer has to be below 1 << SPRITE_KEY_LAYER_BITS.
+	void queue_sprite(const VulkanSprite& sprite, uint32_t layer);
+	void queue_sprites(const std::vector<VulkanSprite>& sprites, uint32_t layer, const VkOffset2D& offset);
 	void clear_queue();
+
+	//Sorts ptr_keys, after which get_sorted() walks the sprites in draw order.
+	void sort();
+
+	//Drops the sorted sprites that would draw nothing on a target of extent, either being
+	//empty, off it, or covered by sprites drawn after them. Leaves the queue sorted.
+	void cull_hidden(VkExtent2D extent);
+
+	const VulkanSprite& get_sorted(uint32_t i) const
+	{
+		return ptr_sprites[ptr_keys[i] & SPRITE_KEY_INDEX_MASK];
+	}
+
+	void reserve(uint32_t more);
+	uint64_t get_sort_key(const VulkanSprite& sprite, uint32_t layer, uint32_t index);
 };
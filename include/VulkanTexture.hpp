@@ -1,23 +1,64 @@
 #pragma once
 
 class Vulkan;
+struct AssetPack;
 //Holds a Texture definition, which is composed of an image, 
 //its size and format, and its location on device memory.
 //
-//TODO: Uploading on demand to the GPU. (I dont think this will be 
-//needed for any of my games, but you never know.)
+//Textures that should only be resident while used go through VulkanTextureStreamer instead.
+//
+//With generate_mipmaps the full mip chain is built on upload by blitting each level
+//down from the one above it, so minified blits and samples read fewer texels.
+//
+//.ktx2 files hold BC1/BC3/BC7 blocks, uploaded as they are when the device can sample
+//and blit the format, decoded to RGBA8 on the CPU otherwise. Their own mip levels are used,
+//generate_mipmaps only applies to decoded files that come with a single level.
+//
+//Textures cooked into an AssetPack are loaded by name, with no decoding at all.
+uint32_t allocate_texture_id();
+
 struct VulkanTexture
 {
-	VulkanTexture(Vulkan* vulkan, const char* texture_file);
+	VulkanTexture(Vulkan* vulkan, const char* texture_file, bool generate_mipmaps = false);
+	VulkanTexture(Vulkan* vulkan, const AssetPack& asset_pack, const char* name, bool generate_mipmaps = false);
+	VulkanTexture(	Vulkan* vulkan,
+					VkFormat format,
+					uint32_t width, uint32_t height,
+					uint32_t level_count,
+					const uint8_t* ptr_data);
 	~VulkanTexture();
 
+	void load_ktx2_texture(const char* texture_file, bool generate_mipmaps);
+
+	void load_levels(	VkFormat format,
+						const uint8_t* ptr_data,
+						uint32_t width, uint32_t height,
+						uint32_t level_count,
+						bool generate_mipmaps);
+
+	void create_image(uint32_t width, uint32_t height, uint32_t level_count);
+
+	void upload(const uint8_t* ptr_data,
+				uint32_t width, uint32_t height,
+				uint32_t level_count,
+				bool generate_mipmaps);
+
+	void upload(uint32_t width, uint32_t height,
+				uint32_t level_count,
+				bool generate_mipmaps,
+				const std::function<void(uint8_t*)>& write_levels);
+
 	Vulkan* 		vulkan_instance;
 
 	VkImage 		image;
 	VkImageView 	image_view;
 	VkExtent2D 		image_extent;
 	VkFormat		image_format;
+	uint32_t 		mip_levels = 1;
 	VkDeviceMemory 	device_memory;
+
+	//Tells textures apart in sprite sort keys, unlike addresses it is never reused.
+	uint32_t 		id = allocate_texture_id();
 };
 
 
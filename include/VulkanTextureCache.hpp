@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Vulkan;
+struct VulkanTexture;
+
+//Shares textures loaded from files, so a file drawn by several fonts or sprites is only
+//uploaded once. Textures are reference counted, every acquire() needs a matching release().
+//A texture whose last reference drops is only destroyed once no frame in flight can still
+//read it, acquiring it again before that brings it back without a reload.
+struct VulkanTextureCache
+{
+	VulkanTextureCache(Vulkan* vulkan);
+	~VulkanTextureCache();
+
+	Vulkan* 	vulkan_instance;
+
+	//Counts update() calls, released textures remember the one they were released in.
+	uint64_t 	frame = 0;
+
+	uint32_t 	hits = 0;
+	uint32_t 	misses = 0;
+
+	struct Entry
+	{
+		VulkanTexture* 	ptr_texture;
+		uint32_t 		ref_count = 0;
+		uint64_t 		released_frame = 0;
+		bool 			in_released_keys = false;
+	};
+
+	//Keyed by canonical path, with a suffix for mipmapped copies.
+	std::unordered_map<std::string, Entry> 				entries;
+	std::unordered_map<VulkanTexture*, std::string> 	texture_keys;
+
+	//Keys whose reference count dropped to 0, checked by update().
+	std::vector<std::string> 							released_keys;
+
+	//The shared texture for file, loading it on the first request.
+	//Different spellings of the same path give the same texture.
+	//The format comes from the file, mipmapped and plain copies are cached separately.
+	VulkanTexture* acquire(const char* file, bool generate_mipmaps = false);
+
+	void release(VulkanTexture* ptr_texture);
+
+	//Destroys released textures no frame can be using anymore.
+	//Call once per frame after waiting on the frame fence.
+	void update();
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Vulkan;
+struct VulkanTexture;
+struct AssetPack;
+
+static const uint32_t TEXTURE_LOADER_THREADS = 2;
+
+enum VulkanStreamedTextureState
+{
+	TEXTURE_UNLOADED,	//Never used yet, or evicted. The next use loads it again.
+	TEXTURE_LOADING,	//Queued on or being decoded by a loader thread.
+	TEXTURE_UPLOADING,	//Has its image, the copy into it is still in flight.
+	TEXTURE_RESIDENT,	//Ready to draw.
+	TEXTURE_FAILED		//Could not be read, the placeholder is drawn instead.
+};
+
+//A texture known to the streamer by its file, only resident while it is being used.
+//file is set when the texture is created and never written again, loader threads read it
+//while decoding. The rest is only touched by the main thread, decoded textures come back
+//through the streamer queues.
+struct VulkanStreamedTexture
+{
+	std::string 				file;
+	VulkanStreamedTextureState 	state = TEXTURE_UNLOADED;
+
+	//Valid while TEXTURE_UPLOADING or TEXTURE_RESIDENT.
+	VulkanTexture* 				ptr_texture = nullptr;
+	VkDeviceSize 				memory_size = 0;
+
+	uint64_t 					last_used_frame = 0;
+};
+
+//Loads textures the first time they are used instead of up front.
+//Files are decoded on loader threads, update() creates their images and copies them in through
+//a persistent staging buffer without waiting on the GPU. Until a texture is resident a small
+//placeholder is drawn in its place.
+//Device memory taken by the textures is kept under memory_budget by evicting the least recently
+//used ones, a texture is only evicted once no frame in flight can still read it.
+struct VulkanTextureStreamer
+{
+	//Textures found in ptr_asset_pack are copied from it, other files are decoded.
+	//generate_mipmaps builds the mip chain on the loader threads for files that have a single level.
+	VulkanTextureStreamer(	Vulkan* vulkan,
+							VkDeviceSize t_memory_budget,
+							VkDeviceSize t_upload_budget,
+							bool t_generate_mipmaps,
+							const AssetPack* t_ptr_asset_pack = nullptr);
+	~VulkanTextureStreamer();
+
+	Vulkan* 			vulkan_instance;
+	const AssetPack* 	ptr_asset_pack;
+	bool 				generate_mipmaps;
+
+	VulkanTexture* 		placeholder;
+
+	VkDeviceSize 		memory_budget;
+	VkDeviceSize 		resident_bytes = 0;
+
+	//Grows when a single texture doesn't fit, several small ones share one submission.
+	VkBuffer 			staging_buffer = VK_NULL_HANDLE;
+	VkDeviceMemory 		staging_buffer_memory = VK_NULL_HANDLE;
+	uint8_t* 			ptr_staging = nullptr;
+	VkDeviceSize 		staging_size = 0;
+
+	VkCommandBuffer 	upload_command_buffer;
+	VkFence 			upload_fence;
+	bool 				upload_pending = false;
+
+	//Counts update() calls, textures remember the last one they could be drawn in.
+	uint64_t 			frame = 0;
+
+	//Every texture ever requested. Owned by the streamer.
+	std::vector<VulkanStreamedTexture*> 					textures;
+	std::unordered_map<std::string, VulkanStreamedTexture*> file_lookup;
+
+	//The same file always gives back the same texture, nothing is loaded until it is used.
+	VulkanStreamedTexture* get_texture(const char* file);
+
+	//The texture to draw this frame: the real one once resident, the placeholder until then.
+	//Marks it as used, the first use starts loading it.
+	VulkanTexture* use_texture(VulkanStreamedTexture* ptr_streamed);
+
+	//Call once per frame from the thread that submits to the graphics queue,
+	//after waiting on the frame fence.
+	void update();
+
+	struct LoadedTexture
+	{
+		VulkanStreamedTexture* 	ptr_streamed;
+		VkFormat 				format = VK_FORMAT_UNDEFINED;
+		uint32_t 				width = 0;
+		uint32_t 				height = 0;
+		uint32_t 				level_count = 0;
+
+		//Levels packed one after another, ready to be copied into staging.
+		std::vector<uint8_t> 	data;
+		std::string 			error_msg;
+
+		//Created once the texture reaches the front of the upload queue, so the budget is
+		//made for its real size. Kept here while no room can be made for it yet.
+		VulkanTexture* 			ptr_texture = nullptr;
+		VkDeviceSize 			memory_size = 0;
+	};
+
+	std::deque<LoadedTexture> 			upload_queue;
+	std::vector<VulkanStreamedTexture*> uploads_in_flight;
+
+	std::vector<std::thread> 			loader_threads;
+	std::mutex 							loader_mutex;
+	std::condition_variable 			loader_condition;
+	std::deque<VulkanStreamedTexture*> 	load_queue;
+	std::deque<LoadedTexture> 			ready_queue;
+	bool 								stop_loader = false;
+
+	void loader_loop();
+	void load(LoadedTexture& loaded);
+	bool make_room(VkDeviceSize size);
+	void evict(VulkanStreamedTexture* ptr_streamed);
+	void resize_staging(VkDeviceSize size);
+	void submit_uploads();
+};
@@ -1,5 +1,16 @@
 #pragma once
 
+//Vertex layouts the renderer can consume.
+//VERTEX_FORMAT_FULL is the plain float Vertex below (32 bytes).
+//VERTEX_FORMAT_COMPACT is VertexCompact (16 bytes), positions quantized to 16 bit snorm
+//inside the mesh bounds, color as RGBA8 and texture coordinates as half floats.
+//Both feed the same vertex shader inputs, the attribute formats do the unpacking.
+enum VertexFormat
+{
+	VERTEX_FORMAT_FULL,
+	VERTEX_FORMAT_COMPACT
+};
+
 struct Vertex
 {
 	Vector3f pos;
@@ -38,4 +49,107 @@ struct Vertex
 
 		return attribute_descriptions;
 	}
-};
\ No newline at end of file
+};
+
+//pos is dequantized with the mesh dequantize transform (see MeshData),
+//pos[3] is padding so the attribute stays 8 byte aligned.
+struct VertexCompact
+{
+	int16_t 	pos[4];
+	uint8_t 	color[4];
+	uint16_t 	tex_coord[2];
+
+	static VkVertexInputBindingDescription get_binding_description()
+	{
+		VkVertexInputBindingDescription binding_description = {};
+
+		binding_description.binding = 0;
+		binding_description.stride = sizeof(VertexCompact);
+		binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return binding_description;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 3> get_attribute_descriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, 3> attribute_descriptions = {};
+
+		attribute_descriptions[0].binding = 0;
+		attribute_descriptions[0].location = 0;
+		attribute_descriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+		attribute_descriptions[0].offset = offsetof(VertexCompact, pos);
+
+		attribute_descriptions[1].binding = 0;
+		attribute_descriptions[1].location = 1;
+		attribute_descriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attribute_descriptions[1].offset = offsetof(VertexCompact, color);
+
+		attribute_descriptions[2].binding = 0;
+		attribute_descriptions[2].location = 2;
+		attribute_descriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attribute_descriptions[2].offset = offsetof(VertexCompact, tex_coord);
+
+		return attribute_descriptions;
+	}
+};
+
+static inline uint32_t get_vertex_stride(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_COMPACT ? sizeof(VertexCompact) : sizeof(Vertex);
+}
+
+static inline VkVertexInputBindingDescription get_vertex_binding_description(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_COMPACT ? 	VertexCompact::get_binding_description() :
+												Vertex::get_binding_description();
+}
+
+static inline std::array<VkVertexInputAttributeDescription, 3> get_vertex_attribute_descriptions(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_COMPACT ? 	VertexCompact::get_attribute_descriptions() :
+												Vertex::get_attribute_descriptions();
+}
+
+//Converts a float to an IEEE half, rounding to nearest.
+//Overflows go to infinity, NaNs stay NaNs and denormals are kept.
+static inline uint16_t float_to_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x007FFFFF;
+
+	if(((bits >> 23) & 0xFF) == 0xFF)
+	{
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	}
+
+	if(exponent >= 31)
+	{
+		return sign | 0x7C00;
+	}
+
+	if(exponent <= 0)
+	{
+		if(exponent < -10) return sign;
+
+		mantissa |= 0x00800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if(remainder > halfway || (remainder == halfway && (half & 1))) half++;
+
+		return sign | half;
+	}
+
+	uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+
+	if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) half++;
+
+	return half;
+}
@@ -1,3 +1,6 @@
 glslc ./shaders/frag.frag -o shaders/frag.spv
 glslc ./shaders/vert.vert -o shaders/vert.spv
-g++ -std=c++17 -Iinclude -I$VULKAN_SDK/vulkan/include -I/usr/include/SDL2 -L$VULKAN_SDK/lib -lm -lSDL2 -lSDL2_image -lvulkan src/*.cpp -o vulkan
+glslc ./shaders/cull.comp -o shaders/cull.spv
+g++ -std=c++17 -pthread -Iinclude -I$VULKAN_SDK/vulkan/include -I/usr/include/SDL2 -L$VULKAN_SDK/lib -lm -lSDL2 -lSDL2_image -lvulkan src/*.cpp -o vulkan
+g++ -std=c++17 -Iinclude -I$VULKAN_SDK/vulkan/include -I/usr/include/SDL2 -lm -lSDL2 -lSDL2_image tools/texture_converter.cpp src/Ktx2.cpp src/TextureCodec.cpp -o texture_converter
+g++ -std=c++17 -Iinclude -I$VULKAN_SDK/vulkan/include -I/usr/include/SDL2 -lm -lSDL2 -lSDL2_image tools/asset_cooker.cpp src/AssetPack.cpp src/Ktx2.cpp src/TextureCodec.cpp -o asset_cooker
@@ -0,0 +1,20 @@
+//Helpers for Affine3f, stored as three row major vec4s. (See include/Affine3f.hpp)
+
+vec3 affine_transform_point(vec4 rows[3], vec3 p)
+{
+	vec4 h = vec4(p, 1.0);
+	return vec3(dot(rows[0], h), dot(rows[1], h), dot(rows[2], h));
+}
+
+vec3 affine_transform_vector(vec4 rows[3], vec3 d)
+{
+	return vec3(dot(rows[0].xyz, d), dot(rows[1].xyz, d), dot(rows[2].xyz, d));
+}
+
+mat4 affine_to_mat4(vec4 rows[3])
+{
+	return mat4(vec4(rows[0].x, rows[1].x, rows[2].x, 0.0),
+				vec4(rows[0].y, rows[1].y, rows[2].y, 0.0),
+				vec4(rows[0].z, rows[1].z, rows[2].z, 0.0),
+				vec4(rows[0].w, rows[1].w, rows[2].w, 1.0));
+}
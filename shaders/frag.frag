@@ -2,10 +2,11 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in float fragOpacity;
 
 layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-    outColor = vec4(fragColor , 1.0);
+    outColor = vec4(fragColor , fragOpacity);
 }
\ No newline at end of file
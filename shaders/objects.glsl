@@ -0,0 +1,11 @@
+//Per object data, matches VulkanObjectData. (See include/VulkanScene.hpp)
+
+struct Object
+{
+	vec4 model[3];			//Object transform with the mesh dequantize folded in.
+	vec4 bounding_sphere;	//xyz center, w radius, before ubo.model.
+	uint batch;				//Instanced draw of its level of detail, the cull shader moves it between levels.
+	float opacity;
+	uint object;			//Index in VulkanScene.
+	uint padding;
+};
@@ -1,20 +1,40 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "affine.glsl"
+#include "objects.glsl"
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out float fragOpacity;
 
 layout(binding = 0) uniform UniformBufferObject
 {
-	mat4 model;
+	vec4 model[3];
 	mat4 view;
 	mat4 proj;
 } ubo;
 
+layout(std430, binding = 2) readonly buffer ObjectBuffer
+{
+	Object objects[];
+};
+
+//Visible objects of every batch, gl_InstanceIndex starts at the batch first_instance.
+layout(std430, binding = 4) readonly buffer InstanceBuffer
+{
+	uint instances[];
+};
+
 void main()
 {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	Object object = objects[instances[gl_InstanceIndex]];
+
+	vec3 position = affine_transform_point(object.model, inPosition);
+	gl_Position = ubo.proj * ubo.view * vec4(affine_transform_point(ubo.model, position), 1.0);
 	fragColor = inColor;
-}
\ No newline at end of file
+	fragOpacity = object.opacity;
+}
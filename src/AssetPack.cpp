@@ -0,0 +1,195 @@
+#include "AssetPack.hpp"
+#include "TextureCodec.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+uint64_t get_asset_name_hash(const char* name)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for(; *name; name++)
+    {
+        hash ^= static_cast<uint8_t>(*name);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+AssetPack::AssetPack(const char* pack_file)
+{
+    int file_descriptor = open(pack_file, O_RDONLY);
+
+    if(file_descriptor < 0)
+    {
+        throw std::runtime_error(std::string("Failed to open asset pack: ") + pack_file);
+    }
+
+    struct stat file_stat;
+
+    if(fstat(file_descriptor, &file_stat) != 0 || size_t(file_stat.st_size) < sizeof(AssetPackHeader))
+    {
+        close(file_descriptor);
+        throw std::runtime_error(std::string("Truncated asset pack: ") + pack_file);
+    }
+
+    mapping_size = file_stat.st_size;
+    void* ptr_map = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+    //The mapping keeps its own reference to the file.
+    close(file_descriptor);
+
+    if(ptr_map == MAP_FAILED)
+    {
+        throw std::runtime_error(std::string("Failed to map asset pack: ") + pack_file);
+    }
+
+    ptr_mapping = static_cast<uint8_t*>(ptr_map);
+
+    AssetPackHeader header;
+    memcpy(&header, ptr_mapping, sizeof(header));
+
+    bool valid =    header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION &&
+                    header.entries_offset % alignof(AssetPackEntry) == 0 &&
+                    header.entries_offset <= mapping_size &&
+                    header.entry_count <= (mapping_size - header.entries_offset) / sizeof(AssetPackEntry) &&
+                    header.names_offset <= mapping_size &&
+                    header.names_size <= mapping_size - header.names_offset;
+
+    ptr_entries = reinterpret_cast<const AssetPackEntry*>(ptr_mapping + header.entries_offset);
+    entry_count = header.entry_count;
+    ptr_names = reinterpret_cast<const char*>(ptr_mapping + header.names_offset);
+
+    for(uint32_t i = 0; i < entry_count && valid; i++)
+    {
+        const AssetPackEntry& entry = ptr_entries[i];
+
+        valid = entry.name_offset <= header.names_size &&
+                entry.name_length <= header.names_size - entry.name_offset &&
+                entry.data_offset <= mapping_size &&
+                entry.data_size <= mapping_size - entry.data_offset &&
+                entry.level_count > 0 &&
+                entry.data_size == get_mip_chain_size(static_cast<VkFormat>(entry.format), entry.width, entry.height, entry.level_count);
+    }
+
+    if(!valid)
+    {
+        munmap(ptr_mapping, mapping_size);
+        throw std::runtime_error(std::string("Malformed asset pack: ") + pack_file);
+    }
+}
+
+AssetPack::~AssetPack()
+{
+    munmap(ptr_mapping, mapping_size);
+}
+
+const AssetPackEntry* AssetPack::find(const char* name) const
+{
+    uint64_t name_hash = get_asset_name_hash(name);
+    size_t name_length = strlen(name);
+
+    const AssetPackEntry* ptr_end = ptr_entries + entry_count;
+    const AssetPackEntry* ptr_entry = std::lower_bound( ptr_entries, ptr_end, name_hash,
+                                                        [](const AssetPackEntry& entry, uint64_t hash)
+                                                        {
+                                                            return entry.name_hash < hash;
+                                                        });
+
+    //Names settle hash collisions.
+    for(; ptr_entry != ptr_end && ptr_entry->name_hash == name_hash; ptr_entry++)
+    {
+        if( ptr_entry->name_length == name_length &&
+            memcmp(ptr_names + ptr_entry->name_offset, name, name_length) == 0)
+        {
+            return ptr_entry;
+        }
+    }
+
+    return nullptr;
+}
+
+void AssetPack::prefetch(const AssetPackEntry& entry) const
+{
+    //madvise wants a page aligned start, chains are aligned to ASSET_PACK_ALIGNMENT already.
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t start = entry.data_offset / page_size * page_size;
+
+    madvise(ptr_mapping + start, entry.data_offset + entry.data_size - start, MADV_WILLNEED);
+}
+
+void save_asset_pack(const char* pack_file, std::vector<AssetPackTexture> textures)
+{
+    std::sort(  textures.begin(), textures.end(),
+                [](const AssetPackTexture& a, const AssetPackTexture& b)
+                {
+                    return get_asset_name_hash(a.name.c_str()) < get_asset_name_hash(b.name.c_str());
+                });
+
+    AssetPackHeader header = {};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = static_cast<uint32_t>(textures.size());
+    header.entries_offset = sizeof(header);
+    header.names_offset = header.entries_offset + textures.size() * sizeof(AssetPackEntry);
+
+    std::vector<AssetPackEntry> entries(textures.size());
+    std::string names;
+
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        const AssetPackTexture& texture = textures[i];
+
+        if(texture.data.size() != get_mip_chain_size(texture.format, texture.width, texture.height, texture.level_count))
+        {
+            throw std::runtime_error("Asset pack texture data does not match its format: " + texture.name);
+        }
+
+        entries[i].name_hash = get_asset_name_hash(texture.name.c_str());
+        entries[i].name_offset = static_cast<uint32_t>(names.size());
+        entries[i].name_length = static_cast<uint32_t>(texture.name.size());
+        entries[i].format = texture.format;
+        entries[i].width = texture.width;
+        entries[i].height = texture.height;
+        entries[i].level_count = texture.level_count;
+        entries[i].data_size = texture.data.size();
+
+        names += texture.name;
+    }
+
+    header.names_size = static_cast<uint32_t>(names.size());
+
+    uint64_t offset = header.names_offset + names.size();
+
+    for(AssetPackEntry& entry : entries)
+    {
+        offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+        entry.data_offset = offset;
+        offset += entry.data_size;
+    }
+
+    std::vector<char> buffer(offset, 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + header.entries_offset, entries.data(), entries.size() * sizeof(AssetPackEntry));
+    memcpy(buffer.data() + header.names_offset, names.data(), names.size());
+
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        memcpy(buffer.data() + entries[i].data_offset, textures[i].data.data(), textures[i].data.size());
+    }
+
+    std::ofstream output(pack_file, std::ios::binary);
+
+    if(!output.write(buffer.data(), buffer.size()))
+    {
+        throw std::runtime_error(std::string("Failed to write asset pack: ") + pack_file);
+    }
+}
@@ -0,0 +1,266 @@
+#include "EntityStore.hpp"
+
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+struct ComponentTypeInfo
+{
+    size_t size;
+    size_t alignment;
+};
+
+static std::mutex component_types_mutex;
+static std::vector<ComponentTypeInfo> component_types;
+
+uint32_t register_component_type(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(component_types_mutex);
+
+    if(component_types.size() >= MAX_COMPONENT_TYPES)
+    {
+        throw std::runtime_error("Too many component types.");
+    }
+
+    component_types.push_back({size, alignment});
+
+    return component_types.size() - 1;
+}
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//Lays out the component arrays for capacity entities, returns the bytes used.
+static size_t layout_chunk(Archetype* ptr_archetype, uint32_t capacity)
+{
+    size_t offset = sizeof(Entity) * capacity;
+
+    for(uint32_t id : ptr_archetype->component_ids)
+    {
+        offset = align_up(offset, component_types[id].alignment);
+        ptr_archetype->offsets[id] = offset;
+        offset += ptr_archetype->sizes[id] * capacity;
+    }
+
+    return offset;
+}
+
+EntityStore::EntityStore()
+{
+    get_archetype(0);
+}
+
+EntityStore::~EntityStore()
+{
+    for(Archetype* ptr_archetype : archetypes)
+    {
+        for(EntityChunk& chunk : ptr_archetype->chunks)
+        {
+            operator delete(chunk.ptr_data, std::align_val_t(64));
+        }
+
+        delete ptr_archetype;
+    }
+}
+
+Archetype* EntityStore::get_archetype(ComponentMask mask)
+{
+    auto found = archetype_lookup.find(mask);
+
+    if(found != archetype_lookup.end())
+    {
+        return found->second;
+    }
+
+    Archetype* ptr_archetype = new Archetype();
+    ptr_archetype->mask = mask;
+
+    size_t entity_size = sizeof(Entity);
+
+    {
+        std::lock_guard<std::mutex> lock(component_types_mutex);
+
+        for(uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++)
+        {
+            if(mask & (ComponentMask(1) << id))
+            {
+                ptr_archetype->component_ids.push_back(id);
+                ptr_archetype->sizes[id] = component_types[id].size;
+                entity_size += component_types[id].size;
+            }
+        }
+
+        //Start from the unpadded estimate and back off until the padding fits too.
+        uint32_t capacity = ENTITY_CHUNK_SIZE / entity_size;
+
+        while(capacity > 0 && layout_chunk(ptr_archetype, capacity) > ENTITY_CHUNK_SIZE)
+        {
+            capacity--;
+        }
+
+        if(capacity == 0)
+        {
+            delete ptr_archetype;
+            throw std::runtime_error("Entity does not fit in a chunk.");
+        }
+
+        ptr_archetype->capacity = capacity;
+    }
+
+    archetypes.push_back(ptr_archetype);
+    archetype_lookup[mask] = ptr_archetype;
+
+    return ptr_archetype;
+}
+
+void EntityStore::allocate_row(Archetype* ptr_archetype, Entity entity, uint32_t& chunk, uint32_t& row)
+{
+    if(ptr_archetype->chunks.empty() || ptr_archetype->chunks.back().count == ptr_archetype->capacity)
+    {
+        EntityChunk new_chunk;
+        new_chunk.ptr_data = static_cast<uint8_t*>(operator new(ENTITY_CHUNK_SIZE, std::align_val_t(64)));
+        new_chunk.count = 0;
+
+        ptr_archetype->chunks.push_back(new_chunk);
+    }
+
+    EntityChunk& last_chunk = ptr_archetype->chunks.back();
+
+    chunk = ptr_archetype->chunks.size() - 1;
+    row = last_chunk.count++;
+
+    ptr_archetype->get_entities(last_chunk)[row] = entity;
+}
+
+//Fills the hole with the last entity of the archetype, so chunks stay packed.
+void EntityStore::free_row(Archetype* ptr_archetype, uint32_t chunk, uint32_t row)
+{
+    EntityChunk& hole_chunk = ptr_archetype->chunks[chunk];
+    EntityChunk& last_chunk = ptr_archetype->chunks.back();
+    uint32_t last_row = last_chunk.count - 1;
+
+    if(&hole_chunk != &last_chunk || row != last_row)
+    {
+        Entity moved = ptr_archetype->get_entities(last_chunk)[last_row];
+        ptr_archetype->get_entities(hole_chunk)[row] = moved;
+
+        for(uint32_t id : ptr_archetype->component_ids)
+        {
+            uint32_t size = ptr_archetype->sizes[id];
+            uint32_t offset = ptr_archetype->offsets[id];
+
+            memcpy(hole_chunk.ptr_data + offset + row * size, last_chunk.ptr_data + offset + last_row * size, size);
+        }
+
+        records[moved.index].chunk = chunk;
+        records[moved.index].row = row;
+    }
+
+    last_chunk.count--;
+
+    if(last_chunk.count == 0)
+    {
+        operator delete(last_chunk.ptr_data, std::align_val_t(64));
+        ptr_archetype->chunks.pop_back();
+    }
+}
+
+uint8_t* EntityStore::get_component_data(const EntityRecord& record, uint32_t id)
+{
+    Archetype* ptr_archetype = record.ptr_archetype;
+
+    return ptr_archetype->chunks[record.chunk].ptr_data + ptr_archetype->offsets[id] + record.row * ptr_archetype->sizes[id];
+}
+
+Entity EntityStore::create_entity()
+{
+    return create_entity_in(archetypes[0]);
+}
+
+//Components of the new row are left uninitialized.
+Entity EntityStore::create_entity_in(Archetype* ptr_archetype)
+{
+    Entity entity;
+
+    if(!free_indices.empty())
+    {
+        entity.index = free_indices.back();
+        free_indices.pop_back();
+    }
+    else
+    {
+        entity.index = records.size();
+        records.push_back({nullptr, 0, 0, 0});
+    }
+
+    EntityRecord& record = records[entity.index];
+    entity.generation = record.generation;
+
+    record.ptr_archetype = ptr_archetype;
+    allocate_row(record.ptr_archetype, entity, record.chunk, record.row);
+
+    entity_count++;
+
+    return entity;
+}
+
+void EntityStore::destroy_entity(Entity entity)
+{
+    if(!is_alive(entity))
+    {
+        return;
+    }
+
+    EntityRecord& record = records[entity.index];
+
+    free_row(record.ptr_archetype, record.chunk, record.row);
+
+    record.ptr_archetype = nullptr;
+    record.generation++;
+    free_indices.push_back(entity.index);
+
+    entity_count--;
+}
+
+bool EntityStore::is_alive(Entity entity) const
+{
+    return  entity.index < records.size() &&
+            records[entity.index].generation == entity.generation &&
+            records[entity.index].ptr_archetype != nullptr;
+}
+
+//Copies the components both archetypes share, the new ones are left uninitialized.
+void EntityStore::move_entity(Entity entity, ComponentMask mask)
+{
+    EntityRecord& record = records[entity.index];
+    Archetype* ptr_source = record.ptr_archetype;
+
+    if(ptr_source->mask == mask)
+    {
+        return;
+    }
+
+    Archetype* ptr_destination = get_archetype(mask);
+
+    uint32_t chunk;
+    uint32_t row;
+    allocate_row(ptr_destination, entity, chunk, row);
+
+    for(uint32_t id : ptr_source->component_ids)
+    {
+        if(mask & (ComponentMask(1) << id))
+        {
+            memcpy( ptr_destination->chunks[chunk].ptr_data + ptr_destination->offsets[id] + row * ptr_destination->sizes[id],
+                    get_component_data(record, id),
+                    ptr_source->sizes[id]);
+        }
+    }
+
+    free_row(ptr_source, record.chunk, record.row);
+
+    record.ptr_archetype = ptr_destination;
+    record.chunk = chunk;
+    record.row = row;
+}
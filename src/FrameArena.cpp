@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "FrameArena.hpp"
+
+FrameArena::FrameArena(size_t t_capacity)
+{
+    capacity = t_capacity;
+    ptr_memory = new uint8_t[capacity];
+}
+
+FrameArena::~FrameArena()
+{
+    for(uint8_t* ptr_block : overflow_blocks)
+    {
+        delete[] ptr_block;
+    }
+
+    delete[] ptr_memory;
+}
+
+//alignment has to be a power of two.
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr_memory);
+    uintptr_t aligned = (base + used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+
+    if(aligned + size <= base + capacity)
+    {
+        used = aligned + size - base;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    //Padded so the block can be aligned whatever new[] returns.
+    uint8_t* ptr_block = new uint8_t[size + alignment];
+    overflow_blocks.push_back(ptr_block);
+    overflow_used += size + alignment;
+
+    uintptr_t block = reinterpret_cast<uintptr_t>(ptr_block);
+    return reinterpret_cast<void*>((block + alignment - 1) & ~(uintptr_t(alignment) - 1));
+}
+
+void FrameArena::reset()
+{
+    size_t frame_used = used + overflow_used;
+    high_water = std::max(high_water, frame_used);
+
+    if(!overflow_blocks.empty())
+    {
+        overflow_count++;
+
+        for(uint8_t* ptr_block : overflow_blocks)
+        {
+            delete[] ptr_block;
+        }
+
+        overflow_blocks.clear();
+        overflow_used = 0;
+
+        while(capacity < frame_used)
+        {
+            capacity *= 2;
+        }
+
+        delete[] ptr_memory;
+        ptr_memory = new uint8_t[capacity];
+    }
+
+    used = 0;
+}
@@ -0,0 +1,118 @@
+#include "JobPool.hpp"
+
+#include <algorithm>
+
+JobPool::JobPool(uint32_t thread_count)
+{
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(&JobPool::worker_loop, this);
+    }
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        stop = true;
+    }
+
+    job_condition.notify_all();
+
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+//Pulls batches of the current job until there are none left.
+void JobPool::run_batches()
+{
+    while(true)
+    {
+        size_t batch = next_batch.fetch_add(1);
+
+        if(batch >= job_batches)
+        {
+            return;
+        }
+
+        size_t first = batch * job_batch_size;
+        size_t last = std::min(first + job_batch_size, job_count);
+
+        (*ptr_function)(first, last);
+
+        if(finished_batches.fetch_add(1) + 1 == job_batches)
+        {
+            std::lock_guard<std::mutex> lock(job_mutex);
+            done_condition.notify_all();
+        }
+    }
+}
+
+void JobPool::worker_loop()
+{
+    uint32_t seen_generation = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(job_mutex);
+            job_condition.wait(lock, [&] { return stop || job_generation != seen_generation; });
+
+            if(stop)
+            {
+                return;
+            }
+
+            seen_generation = job_generation;
+            active_workers++;
+        }
+
+        run_batches();
+
+        {
+            std::lock_guard<std::mutex> lock(job_mutex);
+            active_workers--;
+        }
+
+        done_condition.notify_all();
+    }
+}
+
+void JobPool::parallel_for(size_t count, size_t batch_size, const std::function<void(size_t, size_t)>& function)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    //Not worth waking anyone up.
+    if(threads.empty() || count <= batch_size)
+    {
+        function(0, count);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(job_mutex);
+
+        //A worker that woke up late for the previous job may still be leaving it.
+        done_condition.wait(lock, [this] { return active_workers == 0; });
+
+        ptr_function = &function;
+        job_count = count;
+        job_batch_size = batch_size;
+        job_batches = (count + batch_size - 1) / batch_size;
+        next_batch = 0;
+        finished_batches = 0;
+        job_generation++;
+    }
+
+    job_condition.notify_all();
+
+    run_batches();
+
+    std::unique_lock<std::mutex> lock(job_mutex);
+    done_condition.wait(lock, [this] { return finished_batches == job_batches && active_workers == 0; });
+}
@@ -0,0 +1,325 @@
+#include "Json.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+const JsonValue* JsonValue::find(const char* key) const
+{
+	if(type != JSON_OBJECT)
+	{
+		return nullptr;
+	}
+
+	for(const auto& member : object)
+	{
+		if(member.first == key)
+		{
+			return &member.second;
+		}
+	}
+
+	return nullptr;
+}
+
+double JsonValue::get_number(const char* key, double fallback) const
+{
+	const JsonValue* value = find(key);
+
+	return (value && value->type == JSON_NUMBER) ? value->number : fallback;
+}
+
+std::string JsonValue::get_string(const char* key, const std::string& fallback) const
+{
+	const JsonValue* value = find(key);
+
+	return (value && value->type == JSON_STRING) ? value->string : fallback;
+}
+
+//Recursive descent over the raw text.
+struct JsonParser
+{
+	const char* text;
+	size_t length;
+	size_t position = 0;
+
+	[[noreturn]] void fail(const char* message)
+	{
+		std::string error_msg = "Failed to parse JSON: ";
+		error_msg.append(message);
+		error_msg.append(" at byte ");
+		error_msg.append(std::to_string(position));
+		throw std::runtime_error(error_msg);
+	}
+
+	void skip_whitespace()
+	{
+		while(position < length && 	(text[position] == ' ' || text[position] == '\t' ||
+										text[position] == '\n' || text[position] == '\r'))
+		{
+			position++;
+		}
+	}
+
+	char peek()
+	{
+		skip_whitespace();
+		return position < length ? text[position] : '\0';
+	}
+
+	void expect(char c)
+	{
+		if(peek() != c)
+		{
+			fail("unexpected character");
+		}
+
+		position++;
+	}
+
+	bool match_literal(const char* literal)
+	{
+		size_t literal_length = strlen(literal);
+
+		if(position + literal_length <= length && strncmp(text + position, literal, literal_length) == 0)
+		{
+			position += literal_length;
+			return true;
+		}
+
+		return false;
+	}
+
+	static void append_utf8(std::string& out, uint32_t code_point)
+	{
+		if(code_point < 0x80)
+		{
+			out.push_back(static_cast<char>(code_point));
+		}
+		else if(code_point < 0x800)
+		{
+			out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+			out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+		}
+		else if(code_point < 0x10000)
+		{
+			out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+		}
+		else
+		{
+			out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+			out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+		}
+	}
+
+	uint32_t parse_hex4()
+	{
+		if(position + 4 > length)
+		{
+			fail("truncated unicode escape");
+		}
+
+		uint32_t value = 0;
+
+		for(int i = 0; i < 4; i++)
+		{
+			char c = text[position++];
+			value <<= 4;
+
+			if(c >= '0' && c <= '9') value |= c - '0';
+			else if(c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+			else if(c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+			else fail("bad unicode escape");
+		}
+
+		return value;
+	}
+
+	std::string parse_string()
+	{
+		expect('"');
+
+		std::string result;
+
+		while(true)
+		{
+			if(position >= length)
+			{
+				fail("unterminated string");
+			}
+
+			char c = text[position++];
+
+			if(c == '"')
+			{
+				break;
+			}
+
+			if(c != '\\')
+			{
+				result.push_back(c);
+				continue;
+			}
+
+			if(position >= length)
+			{
+				fail("unterminated escape");
+			}
+
+			char escape = text[position++];
+
+			switch(escape)
+			{
+				case '"': result.push_back('"'); break;
+				case '\\': result.push_back('\\'); break;
+				case '/': result.push_back('/'); break;
+				case 'b': result.push_back('\b'); break;
+				case 'f': result.push_back('\f'); break;
+				case 'n': result.push_back('\n'); break;
+				case 'r': result.push_back('\r'); break;
+				case 't': result.push_back('\t'); break;
+				case 'u':
+				{
+					uint32_t code_point = parse_hex4();
+
+					//Surrogate pair.
+					if(code_point >= 0xD800 && code_point < 0xDC00 && match_literal("\\u"))
+					{
+						uint32_t low = parse_hex4();
+						code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+					}
+
+					append_utf8(result, code_point);
+					break;
+				}
+				default: fail("bad escape");
+			}
+		}
+
+		return result;
+	}
+
+	JsonValue parse_value(int depth)
+	{
+		if(depth > 256)
+		{
+			fail("nested too deep");
+		}
+
+		JsonValue value;
+
+		char c = peek();
+
+		if(c == '{')
+		{
+			position++;
+			value.type = JSON_OBJECT;
+
+			if(peek() == '}')
+			{
+				position++;
+				return value;
+			}
+
+			while(true)
+			{
+				std::string key = parse_string();
+				expect(':');
+				value.object.emplace_back(key, parse_value(depth + 1));
+
+				c = peek();
+				position++;
+
+				if(c == '}') break;
+				if(c != ',') fail("expected , or }");
+			}
+		}
+		else if(c == '[')
+		{
+			position++;
+			value.type = JSON_ARRAY;
+
+			if(peek() == ']')
+			{
+				position++;
+				return value;
+			}
+
+			while(true)
+			{
+				value.array.push_back(parse_value(depth + 1));
+
+				c = peek();
+				position++;
+
+				if(c == ']') break;
+				if(c != ',') fail("expected , or ]");
+			}
+		}
+		else if(c == '"')
+		{
+			value.type = JSON_STRING;
+			value.string = parse_string();
+		}
+		else if(match_literal("true"))
+		{
+			value.type = JSON_BOOL;
+			value.boolean = true;
+		}
+		else if(match_literal("false"))
+		{
+			value.type = JSON_BOOL;
+			value.boolean = false;
+		}
+		else if(match_literal("null"))
+		{
+			value.type = JSON_NULL;
+		}
+		else if(c == '-' || (c >= '0' && c <= '9'))
+		{
+			//strtod needs a terminated string, numbers are short so copy them out.
+			size_t start = position;
+
+			while(position < length && text[position] != '\0' && strchr("+-0123456789.eE", text[position]))
+			{
+				position++;
+			}
+
+			std::string number(text + start, position - start);
+			char* end = nullptr;
+
+			value.type = JSON_NUMBER;
+			value.number = strtod(number.c_str(), &end);
+
+			if(end != number.c_str() + number.size())
+			{
+				fail("bad number");
+			}
+		}
+		else
+		{
+			fail("unexpected character");
+		}
+
+		return value;
+	}
+};
+
+JsonValue json_parse(const char* text, size_t length)
+{
+	JsonParser parser = {text, length};
+
+	JsonValue value = parser.parse_value(0);
+
+	if(parser.peek() != '\0')
+	{
+		parser.fail("trailing characters");
+	}
+
+	return value;
+}
@@ -0,0 +1,234 @@
+#include <cmath>
+#include <stdexcept>
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+#include "Ktx2.hpp"
+#include "TextureCodec.hpp"
+#include "Util.hpp"
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+//Everything up to the level index, as laid out in the file.
+struct Ktx2Header
+{
+    uint8_t     identifier[12];
+    uint32_t    vk_format;
+    uint32_t    type_size;
+    uint32_t    pixel_width;
+    uint32_t    pixel_height;
+    uint32_t    pixel_depth;
+    uint32_t    layer_count;
+    uint32_t    face_count;
+    uint32_t    level_count;
+    uint32_t    supercompression_scheme;
+
+    uint32_t    dfd_byte_offset;
+    uint32_t    dfd_byte_length;
+    uint32_t    kvd_byte_offset;
+    uint32_t    kvd_byte_length;
+    uint64_t    sgd_byte_offset;
+    uint64_t    sgd_byte_length;
+};
+
+struct Ktx2Level
+{
+    uint64_t    byte_offset;
+    uint64_t    byte_length;
+    uint64_t    uncompressed_byte_length;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout.");
+static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index entries must match the file layout.");
+
+Ktx2Image load_ktx2(const char* file)
+{
+    std::vector<char> buffer = read_file(file);
+
+    Ktx2Header header;
+
+    if(buffer.size() < sizeof(header))
+    {
+        throw std::runtime_error(std::string("Truncated KTX2 file: ") + file);
+    }
+
+    memcpy(&header, buffer.data(), sizeof(header));
+
+    if(memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        throw std::runtime_error(std::string("Not a KTX2 file: ") + file);
+    }
+
+    if(header.supercompression_scheme != 0)
+    {
+        throw std::runtime_error(std::string("Supercompressed KTX2 files are not supported: ") + file);
+    }
+
+    if( header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth > 1 ||
+        header.layer_count > 1 || header.face_count != 1)
+    {
+        throw std::runtime_error(std::string("Only 2D KTX2 textures are supported: ") + file);
+    }
+
+    //A level count of 0 asks the loader to build the mip chain, the file holds just the base level.
+    uint32_t level_count = std::max(header.level_count, 1u);
+
+    if(buffer.size() < sizeof(header) + level_count * sizeof(Ktx2Level))
+    {
+        throw std::runtime_error(std::string("Truncated KTX2 level index: ") + file);
+    }
+
+    Ktx2Image image;
+    image.format = static_cast<VkFormat>(header.vk_format);
+    image.width = header.pixel_width;
+    image.height = header.pixel_height;
+    image.levels.resize(level_count);
+
+    for(uint32_t level = 0; level < level_count; level++)
+    {
+        Ktx2Level level_index;
+        memcpy(&level_index, buffer.data() + sizeof(header) + level * sizeof(Ktx2Level), sizeof(level_index));
+
+        if( level_index.byte_offset > buffer.size() ||
+            level_index.byte_length > buffer.size() - level_index.byte_offset)
+        {
+            throw std::runtime_error(std::string("KTX2 level out of bounds: ") + file);
+        }
+
+        const char* ptr_level = buffer.data() + level_index.byte_offset;
+        image.levels[level].assign(ptr_level, ptr_level + level_index.byte_length);
+    }
+
+    return image;
+}
+
+//Data format descriptor
+static const uint32_t KHR_DF_MODEL_BC1A = 128;
+static const uint32_t KHR_DF_MODEL_BC3 = 130;
+static const uint32_t KHR_DF_MODEL_BC7 = 134;
+static const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+static const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+static const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+static const uint32_t KHR_DF_CHANNEL_COLOR = 0;
+static const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+static const uint32_t KHR_DF_CHANNEL_BC1A_ALPHAPRESENT = 1;
+
+//One basic descriptor block with a sample per channel stored in the block.
+static std::vector<uint32_t> build_dfd(VkFormat format)
+{
+    uint32_t model;
+    bool srgb = false;
+
+    //{bit offset, bit length, channel}
+    std::vector<std::array<uint32_t, 3>> samples;
+
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples.push_back({0, 64, KHR_DF_CHANNEL_COLOR});
+            break;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples.push_back({0, 64, KHR_DF_CHANNEL_BC1A_ALPHAPRESENT});
+            break;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC3;
+            samples.push_back({0, 64, KHR_DF_CHANNEL_ALPHA});
+            samples.push_back({64, 64, KHR_DF_CHANNEL_COLOR});
+            break;
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC7;
+            samples.push_back({0, 128, KHR_DF_CHANNEL_COLOR});
+            break;
+        default:
+            throw std::runtime_error("Only block compressed KTX2 files can be saved.");
+    }
+
+    uint32_t block_size = 24 + 16 * samples.size();
+
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + block_size);
+    dfd.push_back(0);
+    dfd.push_back(2 | (block_size << 16));
+    dfd.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | ((srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+    //4x4x1x1 texels, dimensions are stored minus one.
+    dfd.push_back(3 | (3 << 8));
+    dfd.push_back(get_block_size(format));
+    dfd.push_back(0);
+
+    for(const std::array<uint32_t, 3>& sample : samples)
+    {
+        dfd.push_back(sample[0] | ((sample[1] - 1) << 16) | (sample[2] << 24));
+        dfd.push_back(0);
+        dfd.push_back(0);
+        dfd.push_back(UINT32_MAX);
+    }
+
+    return dfd;
+}
+
+void save_ktx2(const char* file, const Ktx2Image& image)
+{
+    std::vector<uint32_t> dfd = build_dfd(image.format);
+
+    uint32_t level_count = static_cast<uint32_t>(image.levels.size());
+    uint32_t alignment = get_block_size(image.format);
+
+    Ktx2Header header = {};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vk_format = image.format;
+    header.type_size = 1;
+    header.pixel_width = image.width;
+    header.pixel_height = image.height;
+    header.face_count = 1;
+    header.level_count = level_count;
+    header.dfd_byte_offset = sizeof(header) + level_count * sizeof(Ktx2Level);
+    header.dfd_byte_length = dfd.size() * sizeof(uint32_t);
+
+    //Levels go smallest first so a streaming reader can show something early,
+    //each one aligned to the block size.
+    std::vector<Ktx2Level> level_index(level_count);
+    uint64_t offset = header.dfd_byte_offset + header.dfd_byte_length;
+
+    for(uint32_t level = level_count; level-- > 0;)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+
+        level_index[level].byte_offset = offset;
+        level_index[level].byte_length = image.levels[level].size();
+        level_index[level].uncompressed_byte_length = image.levels[level].size();
+
+        offset += image.levels[level].size();
+    }
+
+    std::vector<char> buffer(offset, 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), level_index.data(), level_count * sizeof(Ktx2Level));
+    memcpy(buffer.data() + header.dfd_byte_offset, dfd.data(), header.dfd_byte_length);
+
+    for(uint32_t level = 0; level < level_count; level++)
+    {
+        memcpy(buffer.data() + level_index[level].byte_offset, image.levels[level].data(), image.levels[level].size());
+    }
+
+    std::ofstream output(file, std::ios::binary);
+
+    if(!output.write(buffer.data(), buffer.size()))
+    {
+        throw std::runtime_error(std::string("Failed to write KTX2 file: ") + file);
+    }
+}
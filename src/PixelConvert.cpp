@@ -0,0 +1,260 @@
+#include <cstring>
+
+#include "SDL2/SDL.h"
+
+#include "PixelConvert.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_CONVERT_X86
+#endif
+
+//Byte shuffle taking 4 pixels of layout to 4 BGRA pixels, -1 bytes come out as 0.
+//3 byte layouts read the first 12 bytes, 4 byte layouts all 16.
+static bool get_shuffle_mask(PixelLayout layout, int8_t mask[16], bool& opaque)
+{
+    static const int8_t rgb8[16]  = {2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1};
+    static const int8_t bgr8[16]  = {0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1};
+    static const int8_t rgba8[16] = {2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15};
+    static const int8_t bgrx8[16] = {0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1};
+
+    const int8_t* ptr_mask;
+
+    switch(layout)
+    {
+        case PIXEL_LAYOUT_RGB8:     ptr_mask = rgb8;  opaque = true;  break;
+        case PIXEL_LAYOUT_BGR8:     ptr_mask = bgr8;  opaque = true;  break;
+        case PIXEL_LAYOUT_RGBA8:    ptr_mask = rgba8; opaque = false; break;
+        case PIXEL_LAYOUT_BGRX8:    ptr_mask = bgrx8; opaque = true;  break;
+        default:
+            return false;
+    }
+
+    memcpy(mask, ptr_mask, 16);
+    return true;
+}
+
+static size_t get_bytes_per_pixel(PixelLayout layout)
+{
+    switch(layout)
+    {
+        case PIXEL_LAYOUT_RGB8:
+        case PIXEL_LAYOUT_BGR8:
+            return 3;
+        case PIXEL_LAYOUT_INDEX8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+#ifdef PIXEL_CONVERT_X86
+
+//Each returns how many pixels it converted, the tail is left to the scalar loop.
+//Loads are 16 bytes, 3 byte layouts stop early enough not to read past the row.
+
+__attribute__((target("ssse3")))
+static size_t convert_row_ssse3(PixelLayout layout, const uint8_t* ptr_src, uint8_t* ptr_dst, size_t count)
+{
+    int8_t mask_bytes[16];
+    bool opaque;
+
+    if(!get_shuffle_mask(layout, mask_bytes, opaque))
+    {
+        return 0;
+    }
+
+    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_bytes));
+    __m128i alpha = _mm_set1_epi32(opaque ? static_cast<int>(0xff000000) : 0);
+
+    size_t stride = get_bytes_per_pixel(layout);
+    size_t min_left = stride == 3 ? 6 : 4;
+    size_t done = 0;
+
+    for(; count - done >= min_left; done += 4)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr_src + done * stride));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr_dst + done * 4), pixels);
+    }
+
+    return done;
+}
+
+//The shuffle works within 128 bit lanes, so each lane gets its own 4 pixels.
+__attribute__((target("avx2")))
+static size_t convert_row_avx2(PixelLayout layout, const uint8_t* ptr_src, uint8_t* ptr_dst, size_t count)
+{
+    int8_t mask_bytes[16];
+    bool opaque;
+
+    if(!get_shuffle_mask(layout, mask_bytes, opaque))
+    {
+        return 0;
+    }
+
+    __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_bytes)));
+    __m256i alpha = _mm256_set1_epi32(opaque ? static_cast<int>(0xff000000) : 0);
+
+    size_t stride = get_bytes_per_pixel(layout);
+    size_t min_left = stride == 3 ? 10 : 8;
+    size_t done = 0;
+
+    for(; count - done >= min_left; done += 8)
+    {
+        const uint8_t* ptr_pixels = ptr_src + done * stride;
+
+        __m256i pixels = _mm256_inserti128_si256(   _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr_pixels))),
+                                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr_pixels + 4 * stride)),
+                                                    1);
+
+        pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, mask), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr_dst + done * 4), pixels);
+    }
+
+    return done;
+}
+
+#endif
+
+void convert_row_to_bgra8(  PixelLayout layout,
+                            const uint8_t* ptr_src,
+                            uint8_t* ptr_dst,
+                            size_t count,
+                            const uint8_t* ptr_palette)
+{
+    if(layout == PIXEL_LAYOUT_BGRA8)
+    {
+        memcpy(ptr_dst, ptr_src, count * 4);
+        return;
+    }
+
+    size_t done = 0;
+
+#ifdef PIXEL_CONVERT_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+
+    if(has_avx2)
+    {
+        done = convert_row_avx2(layout, ptr_src, ptr_dst, count);
+    }
+    else if(has_ssse3)
+    {
+        done = convert_row_ssse3(layout, ptr_src, ptr_dst, count);
+    }
+#endif
+
+    size_t stride = get_bytes_per_pixel(layout);
+
+    for(size_t i = done; i < count; i++)
+    {
+        const uint8_t* ptr_pixel = ptr_src + i * stride;
+        uint8_t* ptr_out = ptr_dst + i * 4;
+
+        switch(layout)
+        {
+            case PIXEL_LAYOUT_RGB8:
+                ptr_out[0] = ptr_pixel[2];
+                ptr_out[1] = ptr_pixel[1];
+                ptr_out[2] = ptr_pixel[0];
+                ptr_out[3] = 0xff;
+                break;
+            case PIXEL_LAYOUT_BGR8:
+                ptr_out[0] = ptr_pixel[0];
+                ptr_out[1] = ptr_pixel[1];
+                ptr_out[2] = ptr_pixel[2];
+                ptr_out[3] = 0xff;
+                break;
+            case PIXEL_LAYOUT_RGBA8:
+                ptr_out[0] = ptr_pixel[2];
+                ptr_out[1] = ptr_pixel[1];
+                ptr_out[2] = ptr_pixel[0];
+                ptr_out[3] = ptr_pixel[3];
+                break;
+            case PIXEL_LAYOUT_BGRX8:
+                ptr_out[0] = ptr_pixel[0];
+                ptr_out[1] = ptr_pixel[1];
+                ptr_out[2] = ptr_pixel[2];
+                ptr_out[3] = 0xff;
+                break;
+            case PIXEL_LAYOUT_INDEX8:
+                memcpy(ptr_out, ptr_palette + ptr_pixel[0] * 4, 4);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static bool get_surface_layout(const SDL_Surface* surface, PixelLayout& layout)
+{
+    switch(surface->format->format)
+    {
+        case SDL_PIXELFORMAT_RGB24:     layout = PIXEL_LAYOUT_RGB8;   return true;
+        case SDL_PIXELFORMAT_BGR24:     layout = PIXEL_LAYOUT_BGR8;   return true;
+        case SDL_PIXELFORMAT_RGBA32:    layout = PIXEL_LAYOUT_RGBA8;  return true;
+        case SDL_PIXELFORMAT_BGRA32:    layout = PIXEL_LAYOUT_BGRA8;  return true;
+        case SDL_PIXELFORMAT_INDEX8:    layout = PIXEL_LAYOUT_INDEX8; return true;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        case SDL_PIXELFORMAT_RGB888:    layout = PIXEL_LAYOUT_BGRX8;  return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool can_convert_surface_to_bgra8(const SDL_Surface* surface)
+{
+    PixelLayout layout;
+
+    if(!get_surface_layout(surface, layout))
+    {
+        return false;
+    }
+
+    //Only a palette can take the color key as alpha for free.
+    Uint32 color_key;
+    bool has_color_key = SDL_GetColorKey(const_cast<SDL_Surface*>(surface), &color_key) == 0;
+
+    return !has_color_key || layout == PIXEL_LAYOUT_INDEX8;
+}
+
+void convert_surface_to_bgra8(SDL_Surface* surface, uint8_t* ptr_dst)
+{
+    PixelLayout layout;
+    get_surface_layout(surface, layout);
+
+    uint8_t palette[256 * 4] = {};
+
+    if(layout == PIXEL_LAYOUT_INDEX8)
+    {
+        SDL_Palette* ptr_palette = surface->format->palette;
+
+        for(int i = 0; i < ptr_palette->ncolors && i < 256; i++)
+        {
+            palette[i * 4 + 0] = ptr_palette->colors[i].b;
+            palette[i * 4 + 1] = ptr_palette->colors[i].g;
+            palette[i * 4 + 2] = ptr_palette->colors[i].r;
+            palette[i * 4 + 3] = ptr_palette->colors[i].a;
+        }
+
+        Uint32 color_key;
+
+        if(SDL_GetColorKey(surface, &color_key) == 0 && color_key < 256)
+        {
+            palette[color_key * 4 + 3] = 0;
+        }
+    }
+
+    size_t width = surface->w;
+
+    for(int y = 0; y < surface->h; y++)
+    {
+        convert_row_to_bgra8(   layout,
+                                static_cast<const uint8_t*>(surface->pixels) + size_t(y) * surface->pitch,
+                                ptr_dst + y * width * 4,
+                                width,
+                                palette);
+    }
+}
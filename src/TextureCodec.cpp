@@ -0,0 +1,876 @@
+#include "TextureCodec.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+uint32_t get_block_size(VkFormat format)
+{
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            return 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t get_compressed_image_size(VkFormat format, uint32_t width, uint32_t height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * get_block_size(format);
+}
+
+size_t get_image_size(VkFormat format, uint32_t width, uint32_t height)
+{
+    switch(format)
+    {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return size_t(width) * height * 4;
+        default:
+            return get_compressed_image_size(format, width, height);
+    }
+}
+
+size_t get_mip_chain_size(VkFormat format, uint32_t width, uint32_t height, uint32_t level_count)
+{
+    size_t size = 0;
+
+    for(uint32_t level = 0; level < level_count; level++)
+    {
+        size += get_image_size(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+    }
+
+    return size;
+}
+
+VkFormat get_decoded_format(VkFormat format)
+{
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        default:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+//BC1/BC3
+static void expand_565(uint16_t color, uint8_t* ptr_rgba)
+{
+    uint8_t r = (color >> 11) & 31;
+    uint8_t g = (color >> 5) & 63;
+    uint8_t b = color & 31;
+
+    ptr_rgba[0] = (r << 3) | (r >> 2);
+    ptr_rgba[1] = (g << 2) | (g >> 4);
+    ptr_rgba[2] = (b << 3) | (b >> 2);
+    ptr_rgba[3] = 255;
+}
+
+//Color palette of a BC1 style block. BC3 always uses four colors,
+//BC1 switches to three colors and transparent black when color0 <= color1.
+static void get_color_palette(uint16_t color0, uint16_t color1, bool allow_transparent, uint8_t palette[4][4])
+{
+    expand_565(color0, palette[0]);
+    expand_565(color1, palette[1]);
+
+    if(color0 > color1 || !allow_transparent)
+    {
+        for(int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        palette[2][3] = 255;
+        palette[3][3] = 255;
+    }
+    else
+    {
+        for(int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        }
+
+        palette[2][3] = 255;
+        memset(palette[3], 0, 4);
+    }
+}
+
+static void get_alpha_palette(uint8_t alpha0, uint8_t alpha1, uint8_t palette[8])
+{
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+
+    if(alpha0 > alpha1)
+    {
+        for(int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+        }
+    }
+    else
+    {
+        for(int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+        }
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void decode_color_block(const uint8_t* ptr_block, bool allow_transparent, uint8_t* ptr_rgba, size_t row_pitch)
+{
+    uint16_t color0 = ptr_block[0] | (ptr_block[1] << 8);
+    uint16_t color1 = ptr_block[2] | (ptr_block[3] << 8);
+    uint32_t indices = ptr_block[4] | (ptr_block[5] << 8) | (ptr_block[6] << 16) | (uint32_t(ptr_block[7]) << 24);
+
+    uint8_t palette[4][4];
+    get_color_palette(color0, color1, allow_transparent, palette);
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        memcpy(ptr_rgba + (i / 4) * row_pitch + (i % 4) * 4, palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+void decode_bc1_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch)
+{
+    decode_color_block(ptr_block, true, ptr_rgba, row_pitch);
+}
+
+void decode_bc3_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch)
+{
+    decode_color_block(ptr_block + 8, false, ptr_rgba, row_pitch);
+
+    uint8_t palette[8];
+    get_alpha_palette(ptr_block[0], ptr_block[1], palette);
+
+    uint64_t indices = 0;
+
+    for(int b = 0; b < 6; b++)
+    {
+        indices |= uint64_t(ptr_block[2 + b]) << (b * 8);
+    }
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        ptr_rgba[(i / 4) * row_pitch + (i % 4) * 4 + 3] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+//BC7
+struct Bc7Mode
+{
+    uint8_t subsets;
+    uint8_t partition_bits;
+    uint8_t rotation_bits;
+    uint8_t index_selection_bits;
+    uint8_t color_bits;
+    uint8_t alpha_bits;
+    uint8_t endpoint_pbits;
+    uint8_t shared_pbits;
+    uint8_t index_bits;
+    uint8_t index_bits2;
+};
+
+static const Bc7Mode BC7_MODES[8] =
+{
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}
+};
+
+//Bit i is the subset of pixel i.
+static const uint16_t BC7_PARTITIONS_2[64] =
+{
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+static const uint8_t BC7_PARTITIONS_3[64][16] =
+{
+    {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1},
+    {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+    {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2},
+    {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+    {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2},
+    {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+    {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2},
+    {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+    {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0},
+    {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+    {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1},
+    {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+    {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2},
+    {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+    {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2},
+    {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+    {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1},
+    {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+    {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0},
+    {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+    {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2},
+    {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+    {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1},
+    {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+    {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1},
+    {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+    {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2},
+    {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+    {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2},
+    {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+    {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2},
+    {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0}
+};
+
+//Anchor pixels store their index with one bit less, subset 0 always anchors at pixel 0.
+static const uint8_t BC7_ANCHORS_2[64] =
+{
+    15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+    15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+    15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+     6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15
+};
+
+static const uint8_t BC7_ANCHORS_3[2][64] =
+{
+    {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+         3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+         3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3
+    },
+    {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+        15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+        15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8
+    }
+};
+
+static const uint8_t BC7_WEIGHTS_2[4] = {0, 21, 43, 64};
+static const uint8_t BC7_WEIGHTS_3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint8_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+//Reads count bits, least significant first, and advances position.
+static uint32_t read_bits(const uint8_t* ptr_block, uint32_t& position, uint32_t count)
+{
+    uint32_t value = 0;
+
+    for(uint32_t i = 0; i < count; i++, position++)
+    {
+        value |= ((ptr_block[position >> 3] >> (position & 7)) & 1) << i;
+    }
+
+    return value;
+}
+
+static uint8_t interpolate_bc7(uint8_t e0, uint8_t e1, uint32_t index, uint32_t bits)
+{
+    const uint8_t* weights = bits == 2 ? BC7_WEIGHTS_2 : (bits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4);
+
+    return ((64 - weights[index]) * e0 + weights[index] * e1 + 32) >> 6;
+}
+
+void decode_bc7_block(const uint8_t* ptr_block, uint8_t* ptr_rgba, size_t row_pitch)
+{
+    uint32_t mode = 0;
+
+    while(mode < 8 && !(ptr_block[0] & (1 << mode)))
+    {
+        mode++;
+    }
+
+    //Reserved mode, decodes to transparent black.
+    if(mode == 8)
+    {
+        for(uint32_t y = 0; y < 4; y++)
+        {
+            memset(ptr_rgba + y * row_pitch, 0, 16);
+        }
+
+        return;
+    }
+
+    const Bc7Mode& info = BC7_MODES[mode];
+    uint32_t position = mode + 1;
+
+    uint32_t partition = read_bits(ptr_block, position, info.partition_bits);
+    uint32_t rotation = read_bits(ptr_block, position, info.rotation_bits);
+    uint32_t index_selection = read_bits(ptr_block, position, info.index_selection_bits);
+
+    //[subset][endpoint][channel]
+    uint32_t endpoints[3][2][4] = {};
+
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        for(uint32_t s = 0; s < info.subsets; s++)
+        {
+            endpoints[s][0][c] = read_bits(ptr_block, position, info.color_bits);
+            endpoints[s][1][c] = read_bits(ptr_block, position, info.color_bits);
+        }
+    }
+
+    for(uint32_t s = 0; s < info.subsets && info.alpha_bits; s++)
+    {
+        endpoints[s][0][3] = read_bits(ptr_block, position, info.alpha_bits);
+        endpoints[s][1][3] = read_bits(ptr_block, position, info.alpha_bits);
+    }
+
+    uint32_t color_bits = info.color_bits;
+    uint32_t alpha_bits = info.alpha_bits;
+
+    if(info.endpoint_pbits || info.shared_pbits)
+    {
+        for(uint32_t s = 0; s < info.subsets; s++)
+        {
+            uint32_t pbits[2];
+            pbits[0] = read_bits(ptr_block, position, 1);
+            pbits[1] = info.shared_pbits ? pbits[0] : read_bits(ptr_block, position, 1);
+
+            for(uint32_t e = 0; e < 2; e++)
+            {
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    endpoints[s][e][c] = (endpoints[s][e][c] << 1) | pbits[e];
+                }
+            }
+        }
+
+        color_bits++;
+        alpha_bits += alpha_bits ? 1 : 0;
+    }
+
+    //Unquantizes by replicating the top bits into the bottom ones.
+    uint8_t colors[3][2][4];
+
+    for(uint32_t s = 0; s < info.subsets; s++)
+    {
+        for(uint32_t e = 0; e < 2; e++)
+        {
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t value = endpoints[s][e][c] << (8 - color_bits);
+                colors[s][e][c] = value | (value >> color_bits);
+            }
+
+            uint32_t value = endpoints[s][e][3] << (8 - alpha_bits);
+            colors[s][e][3] = alpha_bits ? (value | (value >> alpha_bits)) : 255;
+        }
+    }
+
+    uint8_t subsets[16];
+    uint8_t anchors[3] = {0, 0, 0};
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        if(info.subsets == 2)
+        {
+            subsets[i] = (BC7_PARTITIONS_2[partition] >> i) & 1;
+        }
+        else if(info.subsets == 3)
+        {
+            subsets[i] = BC7_PARTITIONS_3[partition][i];
+        }
+        else
+        {
+            subsets[i] = 0;
+        }
+    }
+
+    if(info.subsets == 2)
+    {
+        anchors[1] = BC7_ANCHORS_2[partition];
+    }
+    else if(info.subsets == 3)
+    {
+        anchors[1] = BC7_ANCHORS_3[0][partition];
+        anchors[2] = BC7_ANCHORS_3[1][partition];
+    }
+
+    uint32_t indices[16];
+    uint32_t indices2[16] = {};
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        indices[i] = read_bits(ptr_block, position, info.index_bits - (i == anchors[subsets[i]] ? 1 : 0));
+    }
+
+    for(uint32_t i = 0; i < 16 && info.index_bits2; i++)
+    {
+        indices2[i] = read_bits(ptr_block, position, info.index_bits2 - (i == 0 ? 1 : 0));
+    }
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        const uint8_t (*ptr_endpoints)[4] = colors[subsets[i]];
+
+        uint32_t color_index = indices[i];
+        uint32_t color_index_bits = info.index_bits;
+        uint32_t alpha_index = indices[i];
+        uint32_t alpha_index_bits = info.index_bits;
+
+        //Modes 4 and 5 keep separate color and alpha indices, the index selection bit swaps them.
+        if(info.index_bits2)
+        {
+            alpha_index = indices2[i];
+            alpha_index_bits = info.index_bits2;
+
+            if(index_selection)
+            {
+                std::swap(color_index, alpha_index);
+                std::swap(color_index_bits, alpha_index_bits);
+            }
+        }
+
+        uint8_t* ptr_pixel = ptr_rgba + (i / 4) * row_pitch + (i % 4) * 4;
+
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            ptr_pixel[c] = interpolate_bc7(ptr_endpoints[0][c], ptr_endpoints[1][c], color_index, color_index_bits);
+        }
+
+        ptr_pixel[3] = interpolate_bc7(ptr_endpoints[0][3], ptr_endpoints[1][3], alpha_index, alpha_index_bits);
+
+        if(rotation)
+        {
+            std::swap(ptr_pixel[3], ptr_pixel[rotation - 1]);
+        }
+    }
+}
+
+void decode_compressed_image(   VkFormat format,
+                                const uint8_t* ptr_blocks,
+                                uint32_t width, uint32_t height,
+                                std::vector<uint8_t>& rgba)
+{
+    uint32_t block_size = get_block_size(format);
+
+    if(block_size == 0)
+    {
+        throw std::runtime_error("Unsupported compressed texture format.");
+    }
+
+    void (*decode_block)(const uint8_t*, uint8_t*, size_t) = decode_bc7_block;
+
+    if(block_size == 8)
+    {
+        decode_block = decode_bc1_block;
+    }
+    else if(format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK)
+    {
+        decode_block = decode_bc3_block;
+    }
+
+    rgba.resize(size_t(width) * height * 4);
+
+    uint8_t block_pixels[4 * 4 * 4];
+
+    for(uint32_t block_y = 0; block_y < height; block_y += 4)
+    {
+        for(uint32_t block_x = 0; block_x < width; block_x += 4, ptr_blocks += block_size)
+        {
+            decode_block(ptr_blocks, block_pixels, 16);
+
+            //BC1 without alpha reads the transparent palette entry as opaque black.
+            if(format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK)
+            {
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    block_pixels[i * 4 + 3] = 255;
+                }
+            }
+
+            //Edge blocks only keep the pixels inside the image.
+            uint32_t copy_width = std::min(width - block_x, 4u);
+            uint32_t copy_height = std::min(height - block_y, 4u);
+
+            for(uint32_t y = 0; y < copy_height; y++)
+            {
+                memcpy( rgba.data() + ((size_t(block_y) + y) * width + block_x) * 4,
+                        block_pixels + y * 16,
+                        copy_width * 4);
+            }
+        }
+    }
+}
+
+static float srgb_to_linear(uint8_t value)
+{
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linear_to_srgb(float value)
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void downsample_image(  const uint8_t* ptr_pixels,
+                        uint32_t width, uint32_t height,
+                        bool srgb,
+                        std::vector<uint8_t>& next_pixels)
+{
+    uint32_t next_width = std::max(width / 2, 1u);
+    uint32_t next_height = std::max(height / 2, 1u);
+
+    next_pixels.resize(size_t(next_width) * next_height * 4);
+
+    for(uint32_t y = 0; y < next_height; y++)
+    {
+        for(uint32_t x = 0; x < next_width; x++)
+        {
+            uint32_t xs[2] = {std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1)};
+            uint32_t ys[2] = {std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1)};
+
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                bool linearize = srgb && c < 3;
+                float sum = 0.0f;
+
+                for(uint32_t sample = 0; sample < 4; sample++)
+                {
+                    uint8_t value = ptr_pixels[(size_t(ys[sample / 2]) * width + xs[sample % 2]) * 4 + c];
+                    sum += linearize ? srgb_to_linear(value) : value;
+                }
+
+                sum *= 0.25f;
+
+                next_pixels[(size_t(y) * next_width + x) * 4 + c] = linearize ? linear_to_srgb(sum) : static_cast<uint8_t>(sum + 0.5f);
+            }
+        }
+    }
+}
+
+//Encoders
+static uint16_t quantize_565(const float* ptr_color)
+{
+    uint32_t r = std::clamp(int(ptr_color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    uint32_t g = std::clamp(int(ptr_color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    uint32_t b = std::clamp(int(ptr_color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+
+    return (r << 11) | (g << 5) | b;
+}
+
+//Fits the pixels marked in use with the two ends of their principal axis.
+static void fit_color_endpoints(const uint8_t pixels[16][4], const bool used[16], float endpoints[2][3])
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        if(used[i])
+        {
+            for(int c = 0; c < 3; c++)
+            {
+                mean[c] += pixels[i][c];
+            }
+
+            count++;
+        }
+    }
+
+    if(count == 0)
+    {
+        memset(endpoints, 0, sizeof(float) * 6);
+        return;
+    }
+
+    for(int c = 0; c < 3; c++)
+    {
+        mean[c] /= count;
+    }
+
+    float covariance[3][3] = {};
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        if(used[i])
+        {
+            float delta[3] = {pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2]};
+
+            for(int a = 0; a < 3; a++)
+            {
+                for(int b = 0; b < 3; b++)
+                {
+                    covariance[a][b] += delta[a] * delta[b];
+                }
+            }
+        }
+    }
+
+    //A few power iterations are enough to find the dominant direction.
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+
+    for(int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[3];
+
+        for(int a = 0; a < 3; a++)
+        {
+            next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+        }
+
+        float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+
+        if(length < 1e-6f)
+        {
+            break;
+        }
+
+        for(int a = 0; a < 3; a++)
+        {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    float min_t = 0.0f;
+    float max_t = 0.0f;
+    bool first = true;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        if(used[i])
+        {
+            float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+
+            if(first || t < min_t)
+            {
+                min_t = t;
+            }
+
+            if(first || t > max_t)
+            {
+                max_t = t;
+            }
+
+            first = false;
+        }
+    }
+
+    float axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    for(int c = 0; c < 3; c++)
+    {
+        endpoints[0][c] = std::clamp(mean[c] + axis[c] * max_t / axis_length_squared, 0.0f, 255.0f);
+        endpoints[1][c] = std::clamp(mean[c] + axis[c] * min_t / axis_length_squared, 0.0f, 255.0f);
+    }
+}
+
+static void encode_color_block(const uint8_t pixels[16][4], bool allow_transparent, uint8_t* ptr_block)
+{
+    bool used[16];
+    bool has_transparent = false;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        used[i] = !allow_transparent || pixels[i][3] >= 128;
+        has_transparent |= !used[i];
+    }
+
+    float endpoints[2][3];
+    fit_color_endpoints(pixels, used, endpoints);
+
+    uint16_t color0 = quantize_565(endpoints[0]);
+    uint16_t color1 = quantize_565(endpoints[1]);
+
+    //Four colors need color0 > color1, three colors plus transparent need the opposite.
+    if((has_transparent && color0 > color1) || (!has_transparent && color0 < color1))
+    {
+        std::swap(color0, color1);
+    }
+
+    uint8_t palette[4][4];
+    get_color_palette(color0, color1, allow_transparent, palette);
+
+    bool four_colors = color0 > color1 || !allow_transparent;
+    uint32_t indices = 0;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t best_index = 3;
+
+        if(used[i])
+        {
+            int best_distance = INT32_MAX;
+            best_index = 0;
+
+            for(uint32_t p = 0; p < (four_colors ? 4u : 3u); p++)
+            {
+                int distance = 0;
+
+                for(int c = 0; c < 3; c++)
+                {
+                    int delta = int(pixels[i][c]) - palette[p][c];
+                    distance += delta * delta;
+                }
+
+                if(distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = p;
+                }
+            }
+        }
+
+        indices |= best_index << (i * 2);
+    }
+
+    ptr_block[0] = color0 & 0xff;
+    ptr_block[1] = color0 >> 8;
+    ptr_block[2] = color1 & 0xff;
+    ptr_block[3] = color1 >> 8;
+
+    for(int b = 0; b < 4; b++)
+    {
+        ptr_block[4 + b] = (indices >> (b * 8)) & 0xff;
+    }
+}
+
+static void encode_alpha_block(const uint8_t pixels[16][4], uint8_t* ptr_block)
+{
+    uint8_t min_alpha = 255;
+    uint8_t max_alpha = 0;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        min_alpha = std::min(min_alpha, pixels[i][3]);
+        max_alpha = std::max(max_alpha, pixels[i][3]);
+    }
+
+    //alpha0 > alpha1 selects the eight interpolated values.
+    uint8_t palette[8];
+    get_alpha_palette(max_alpha, min_alpha, palette);
+
+    uint64_t indices = 0;
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t best_index = 0;
+        int best_distance = INT32_MAX;
+
+        for(uint32_t p = 0; p < 8; p++)
+        {
+            int distance = std::abs(int(pixels[i][3]) - palette[p]);
+
+            if(distance < best_distance)
+            {
+                best_distance = distance;
+                best_index = p;
+            }
+        }
+
+        indices |= uint64_t(best_index) << (i * 3);
+    }
+
+    ptr_block[0] = max_alpha;
+    ptr_block[1] = min_alpha;
+
+    for(int b = 0; b < 6; b++)
+    {
+        ptr_block[2 + b] = (indices >> (b * 8)) & 0xff;
+    }
+}
+
+static void gather_block(const uint8_t* ptr_rgba, size_t row_pitch, uint8_t pixels[16][4])
+{
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        memcpy(pixels[i], ptr_rgba + (i / 4) * row_pitch + (i % 4) * 4, 4);
+    }
+}
+
+void encode_bc1_block(const uint8_t* ptr_rgba, size_t row_pitch, uint8_t* ptr_block)
+{
+    uint8_t pixels[16][4];
+    gather_block(ptr_rgba, row_pitch, pixels);
+
+    encode_color_block(pixels, true, ptr_block);
+}
+
+void encode_bc3_block(const uint8_t* ptr_rgba, size_t row_pitch, uint8_t* ptr_block)
+{
+    uint8_t pixels[16][4];
+    gather_block(ptr_rgba, row_pitch, pixels);
+
+    encode_alpha_block(pixels, ptr_block);
+    encode_color_block(pixels, false, ptr_block + 8);
+}
+
+void encode_compressed_image(   VkFormat format,
+                                const uint8_t* ptr_rgba,
+                                uint32_t width, uint32_t height,
+                                std::vector<uint8_t>& blocks)
+{
+    bool bc1 = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+               format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    bool bc3 = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+
+    if(!bc1 && !bc3)
+    {
+        throw std::runtime_error("Only BC1 and BC3 can be encoded.");
+    }
+
+    uint32_t block_size = get_block_size(format);
+    blocks.resize(get_compressed_image_size(format, width, height));
+
+    uint8_t* ptr_block = blocks.data();
+    uint8_t block_pixels[4 * 4 * 4];
+
+    for(uint32_t block_y = 0; block_y < height; block_y += 4)
+    {
+        for(uint32_t block_x = 0; block_x < width; block_x += 4, ptr_block += block_size)
+        {
+            for(uint32_t y = 0; y < 4; y++)
+            {
+                for(uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t source_x = std::min(block_x + x, width - 1);
+                    uint32_t source_y = std::min(block_y + y, height - 1);
+
+                    memcpy(block_pixels + y * 16 + x * 4, ptr_rgba + (size_t(source_y) * width + source_x) * 4, 4);
+                }
+            }
+
+            if(bc1)
+            {
+                encode_bc1_block(block_pixels, 16, ptr_block);
+            }
+            else
+            {
+                encode_bc3_block(block_pixels, 16, ptr_block);
+            }
+        }
+    }
+}
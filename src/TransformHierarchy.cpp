@@ -0,0 +1,71 @@
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+uint32_t TransformHierarchy::add_node(uint32_t parent, const Affine3f& local_transform)
+{
+    uint32_t node = parents.size();
+
+    //What keeps parents before their children.
+    if(parent != NO_PARENT && parent >= node)
+    {
+        throw std::runtime_error("Transform node parent does not exist.");
+    }
+
+    parents.push_back(parent);
+    local_transforms.push_back(local_transform);
+    world_transforms.push_back(local_transform);
+    dirty.push_back(1);
+    changed.push_back(0);
+
+    first_dirty = std::min(first_dirty, node);
+
+    return node;
+}
+
+void TransformHierarchy::set_local_transform(uint32_t node, const Affine3f& local_transform)
+{
+    local_transforms[node] = local_transform;
+    dirty[node] = 1;
+
+    first_dirty = std::min(first_dirty, node);
+}
+
+void TransformHierarchy::update()
+{
+    memset(changed.data(), 0, changed.size());
+
+    if(first_dirty == UINT32_MAX)
+    {
+        return;
+    }
+
+    uint32_t node_count = parents.size();
+
+    //Parents are always done by the time their children are reached,
+    //so a changed parent drags its whole subtree along.
+    for(uint32_t node = first_dirty; node < node_count; node++)
+    {
+        uint32_t parent = parents[node];
+
+        if(parent == NO_PARENT)
+        {
+            if(dirty[node])
+            {
+                world_transforms[node] = local_transforms[node];
+                changed[node] = 1;
+            }
+        }
+        else if(dirty[node] || changed[parent])
+        {
+            world_transforms[node] = world_transforms[parent] * local_transforms[node];
+            changed[node] = 1;
+        }
+
+        dirty[node] = 0;
+    }
+
+    first_dirty = UINT32_MAX;
+}
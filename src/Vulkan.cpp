@@ -3,21 +3,36 @@
 //Initializes all of the vulkan systems
 Vulkan::Vulkan()
 {
+    job_pool = new JobPool();
+
+    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        frame_arenas.push_back(new FrameArena(1 << 20));
+    }
+
+    sprite_queue.ptr_arena = frame_arenas[0];
+
     create_vulkan_instance();
     setup_debug_messenger();
     pick_physical_device();
     create_logical_device();
     create_swap_chain();
     create_render_targets();
+    create_depth_targets();
     create_render_pass();
     create_descriptor_set_layout();
     create_graphics_pipeline();
+    create_cull_pipeline();
     create_framebuffers();
     create_command_pool();
     create_texture_sampler();
-    create_vertex_buffer();
-    create_index_buffer();
+    create_mesh_pool();
+    create_texture_streamer();
+    create_damage_tracking();
+    texture_cache = new VulkanTextureCache(this);
+    layer_cache = new VulkanLayerCache(this);
     create_uniform_buffers();
+    create_object_buffers();
     create_descriptor_pool();
     create_descriptor_sets();
     create_render_command_buffers();
@@ -36,7 +51,26 @@ Vulkan::~Vulkan()
 
     vkDestroySampler(logical_device, texture_sampler, nullptr);
 
+    vkDestroyBuffer(logical_device, damage_clear_buffer, nullptr);
+    vkFreeMemory(logical_device, damage_clear_buffer_memory, nullptr);
+
+    for(size_t i = 0; i < heatmap_buffers.size(); i++)
+    {
+        vkDestroyBuffer(logical_device, heatmap_buffers[i], nullptr);
+        vkFreeMemory(logical_device, heatmap_buffers_memory[i], nullptr);
+    }
+
     delete tiny_font;
+    delete layer_cache;
+    delete texture_cache;
+    delete texture_streamer;
+    delete mesh_pool;
+    delete job_pool;
+
+    for(FrameArena* ptr_arena : frame_arenas)
+    {
+        delete ptr_arena;
+    }
     destroy_sync_objects();
 
     vkDestroyCommandPool(logical_device, command_pool, nullptr);
@@ -47,7 +81,14 @@ Vulkan::~Vulkan()
     }
 
     vkDestroyPipeline(logical_device, graphics_pipeline, nullptr);
+    vkDestroyPipeline(logical_device, transparent_pipeline, nullptr);
     vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
+
+    if(gpu_culling_supported)
+    {
+        vkDestroyPipeline(logical_device, cull_pipeline, nullptr);
+        vkDestroyPipelineLayout(logical_device, cull_pipeline_layout, nullptr);
+    }
     vkDestroyRenderPass(logical_device, render_pass, nullptr);
 
     for (auto render_target_mem : render_target_device_memory) 
@@ -65,6 +106,13 @@ Vulkan::~Vulkan()
         vkDestroyImageView(logical_device, render_target_image_view, nullptr);
     }
    
+    for (size_t i = 0; i < depth_images.size(); i++) 
+    {
+        vkDestroyImageView(logical_device, depth_image_views[i], nullptr);
+        vkDestroyImage(logical_device, depth_images[i], nullptr);
+        vkFreeMemory(logical_device, depth_images_memory[i], nullptr);
+    }
+
     for (auto image_view : swap_chain_image_views) 
     {
         vkDestroyImageView(logical_device, image_view, nullptr);
@@ -74,16 +122,12 @@ Vulkan::~Vulkan()
 
     vkDestroyDescriptorSetLayout(logical_device, descriptor_set_layout, nullptr);
 
-    vkDestroyBuffer(logical_device, vertex_buffer, nullptr);
-    vkFreeMemory(logical_device, vertex_buffer_memory, nullptr);
-    
-    vkDestroyBuffer(logical_device, index_buffer, nullptr);
-    vkFreeMemory(logical_device, index_buffer_memory, nullptr);       
-
     for(size_t i = 0; i < swap_chain_images.size(); i++)
     {
         vkDestroyBuffer(logical_device, uniform_buffers[i], nullptr);
         vkFreeMemory(logical_device, uniform_buffers_memory[i], nullptr);
+
+        destroy_object_buffer(i);
     }
 
     vkDestroyDescriptorPool(logical_device, descriptor_pool, nullptr);
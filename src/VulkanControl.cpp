@@ -10,7 +10,8 @@ void Vulkan::create_command_pool()
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = 0; // Optional
+    //Start buffers are re-recorded when new meshes land, the mesh upload buffer is reused.
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (vkCreateCommandPool(logical_device, &poolInfo, nullptr, &command_pool) != VK_SUCCESS) 
     {
@@ -50,66 +51,522 @@ void Vulkan::create_buffer(     VkDeviceSize size, VkBufferUsageFlags usage,
 }
 
 //CREATES INTERACTION BUFFERS
-//Creates the Vertex buffer
-void Vulkan::create_vertex_buffer()
+//Creates the mesh pool and starts streaming the scene meshes into it.
+void Vulkan::create_mesh_pool()
 {
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
-    
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    mesh_pool = new VulkanMeshPool( this,
+                                    vertex_format,
+                                    1 << 20,
+                                    16 << 20,
+                                    1 << 20);
+
+    cube_mesh = mesh_pool->load_mesh("data/cube.obj");
+    uint32_t cube_node = hierarchy.add_node(TransformHierarchy::NO_PARENT, a3f_identity());
+    uint32_t cube_object = scene.add_object(cube_mesh, a3f_identity());
+    scene.attach_to_node(cube_object, cube_node, hierarchy);
+}
+
+//Sprite textures get 64MB of device memory, uploads start with a 4MB staging buffer.
+void Vulkan::create_texture_streamer()
+{
+    texture_streamer = new VulkanTextureStreamer(   this,
+                                                    64 << 20,
+                                                    4 << 20,
+                                                    true);
+}
 
-    create_buffer(  buffer_size, 
-                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+//Sets up the damage tracker and the opaque black buffer damaged rects are cleared from,
+//one render target in size so every rect reads it at its own offset.
+//Partial redraws assume a swapchain image still holds what was last presented from it when it
+//is acquired again, which only an unclipped swapchain guarantees for obscured pixels.
+void Vulkan::create_damage_tracking()
+{
+    damage_tracker.init(render_target_image_extent, swap_chain_images.size());
+
+    bool clearable_format = swap_chain_image_format == VK_FORMAT_B8G8R8A8_SRGB ||
+                            swap_chain_image_format == VK_FORMAT_B8G8R8A8_UNORM ||
+                            swap_chain_image_format == VK_FORMAT_R8G8B8A8_SRGB ||
+                            swap_chain_image_format == VK_FORMAT_R8G8B8A8_UNORM;
+
+    partial_redraw_supported =  clearable_format &&
+                                !swap_chain_clipped &&
+                                swap_chain_image_extent.width % render_target_image_extent.width == 0 &&
+                                swap_chain_image_extent.height % render_target_image_extent.height == 0;
+
+    VkDeviceSize size = VkDeviceSize(render_target_image_extent.width) * render_target_image_extent.height * 4;
+
+    create_buffer(  size,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    staging_buffer,
-                    staging_buffer_memory);
+                    damage_clear_buffer,
+                    damage_clear_buffer_memory);
 
-    void* data;
-    vkMapMemory(logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-        memcpy(data, vertices.data(), (size_t) buffer_size);
-    vkUnmapMemory(logical_device, staging_buffer_memory);
+    void* ptr_data;
+    vkMapMemory(logical_device, damage_clear_buffer_memory, 0, size, 0, &ptr_data);
+    std::fill_n(static_cast<uint32_t*>(ptr_data), size / 4, 0xff000000u);
+    vkUnmapMemory(logical_device, damage_clear_buffer_memory);
+}
 
-    create_buffer(  buffer_size, 
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                    vertex_buffer,
-                    vertex_buffer_memory);
+//The heatmap buffers are only made the first time it's shown. Either way every image holds
+//the other view afterwards, so none of them can be patched or have its buffer submitted again.
+void Vulkan::set_overdraw_heatmap(bool enabled)
+{
+    bool heatmap_format =   render_target_image_format == VK_FORMAT_B8G8R8A8_SRGB ||
+                            render_target_image_format == VK_FORMAT_B8G8R8A8_UNORM ||
+                            render_target_image_format == VK_FORMAT_R8G8B8A8_SRGB ||
+                            render_target_image_format == VK_FORMAT_R8G8B8A8_UNORM;
 
-    exec_copy_buffer_cmd(staging_buffer, vertex_buffer, buffer_size);
+    if(enabled && !heatmap_format)
+    {
+        throw std::runtime_error("Overdraw heatmap needs a 4 byte render target format.");
+    }
 
-    vkDestroyBuffer(logical_device, staging_buffer, nullptr);
-    vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
-}   
+    if(enabled && heatmap_buffers.empty())
+    {
+        VkDeviceSize size = VkDeviceSize(render_target_image_extent.width) * render_target_image_extent.height * 4;
 
-//Creates the Index buffer.
-void Vulkan::create_index_buffer()
+        heatmap_buffers.resize(swap_chain_images.size());
+        heatmap_buffers_memory.resize(swap_chain_images.size());
+        heatmap_buffers_mapped.resize(swap_chain_images.size());
+
+        for(size_t i = 0; i < swap_chain_images.size(); i++)
+        {
+            create_buffer(  size,
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            heatmap_buffers[i],
+                            heatmap_buffers_memory[i]);
+
+            vkMapMemory(logical_device, heatmap_buffers_memory[i], 0, size, 0, &heatmap_buffers_mapped[i]);
+        }
+    }
+
+    overdraw.heatmap = enabled;
+
+    damage_tracker.invalidate();
+    std::fill(command_buffers_dynamic_reusable.begin(), command_buffers_dynamic_reusable.end(), 0);
+}
+
+//Changes whenever the scene or the set of resident meshes does. Each counter keeps its own
+//half, so a change in one can never be cancelled out by the other.
+uint64_t Vulkan::get_scene_generation()
 {
-    VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
-    
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    return (uint64_t(mesh_pool->generation) << 32) | scene.generation;
+}
+
+//Creates the per image object and indirect draw buffers.
+void Vulkan::create_object_buffers()
+{
+    object_buffers.resize(swap_chain_images.size());
+    object_buffers_memory.resize(swap_chain_images.size());
+    object_buffers_mapped.resize(swap_chain_images.size());
+    indirect_buffers.resize(swap_chain_images.size());
+    indirect_buffers_memory.resize(swap_chain_images.size());
+    batch_buffers.resize(swap_chain_images.size());
+    batch_buffers_memory.resize(swap_chain_images.size());
+    batch_buffers_mapped.resize(swap_chain_images.size());
+    instance_buffers.resize(swap_chain_images.size());
+    instance_buffers_memory.resize(swap_chain_images.size());
+    instance_buffers_mapped.resize(swap_chain_images.size());
+    object_buffers_capacity.resize(swap_chain_images.size());
+    object_buffers_moved.resize(swap_chain_images.size());
+
+    for (size_t i = 0; i < swap_chain_images.size(); i++)
+    {
+        create_object_buffer(i, 1024);
+    }
+}
 
-    create_buffer(  buffer_size, 
-                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+void Vulkan::create_object_buffer(uint32_t current_image, uint32_t capacity)
+{
+    //Written from the CPU only when the scene changes or objects move, so it can stay host visible.
+    //The cull shader writes back the level of detail of every object.
+    create_buffer(  capacity * sizeof(VulkanObjectData),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    staging_buffer,
-                    staging_buffer_memory);
+                    object_buffers[current_image],
+                    object_buffers_memory[current_image]);
 
-    void* data;
-    vkMapMemory(logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-        memcpy(data, indices.data(), (size_t) buffer_size);
-    vkUnmapMemory(logical_device, staging_buffer_memory);
+    vkMapMemory(logical_device, object_buffers_memory[current_image], 0, capacity * sizeof(VulkanObjectData), 0, &object_buffers_mapped[current_image]);
 
-    create_buffer(  buffer_size, 
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
+    //Reset from the batch buffer then filled in by the cull shader.
+    //Every object adds at most one batch and one instance slot per level of detail.
+    create_buffer(  capacity * MAX_MESH_LODS * sizeof(VulkanDrawCommand),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                    index_buffer,
-                    index_buffer_memory);
+                    indirect_buffers[current_image],
+                    indirect_buffers_memory[current_image]);
+
+    //The batches with no instances yet.
+    create_buffer(  capacity * MAX_MESH_LODS * sizeof(VulkanDrawCommand),
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    batch_buffers[current_image],
+                    batch_buffers_memory[current_image]);
+
+    vkMapMemory(logical_device, batch_buffers_memory[current_image], 0, capacity * MAX_MESH_LODS * sizeof(VulkanDrawCommand), 0, &batch_buffers_mapped[current_image]);
+
+    //Object index of every drawn instance, written by the cull shader or write_visible_instances.
+    create_buffer(  capacity * MAX_MESH_LODS * sizeof(uint32_t),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    instance_buffers[current_image],
+                    instance_buffers_memory[current_image]);
+
+    vkMapMemory(logical_device, instance_buffers_memory[current_image], 0, capacity * MAX_MESH_LODS * sizeof(uint32_t), 0, &instance_buffers_mapped[current_image]);
+
+    object_buffers_capacity[current_image] = capacity;
+}
+
+void Vulkan::destroy_object_buffer(uint32_t current_image)
+{
+    vkUnmapMemory(logical_device, object_buffers_memory[current_image]);
+    vkDestroyBuffer(logical_device, object_buffers[current_image], nullptr);
+    vkFreeMemory(logical_device, object_buffers_memory[current_image], nullptr);
+
+    vkDestroyBuffer(logical_device, indirect_buffers[current_image], nullptr);
+    vkFreeMemory(logical_device, indirect_buffers_memory[current_image], nullptr);
+
+    vkUnmapMemory(logical_device, batch_buffers_memory[current_image]);
+    vkDestroyBuffer(logical_device, batch_buffers[current_image], nullptr);
+    vkFreeMemory(logical_device, batch_buffers_memory[current_image], nullptr);
+
+    vkUnmapMemory(logical_device, instance_buffers_memory[current_image]);
+    vkDestroyBuffer(logical_device, instance_buffers[current_image], nullptr);
+    vkFreeMemory(logical_device, instance_buffers_memory[current_image], nullptr);
+}
+
+//Marks the scene objects touching the frustum of view_proj in scene_objects_visible.
+//Large scenes are split across the job pool.
+void Vulkan::cull_scene_objects(const Matrix4f& view_proj)
+{
+    Frustum frustum = frustum_from_matrix4f(view_proj);
+
+    job_pool->parallel_for( scene_objects.size(), 16384,
+                            [&](size_t first, size_t last)
+                            {
+                                frustum_test_spheres(   frustum,
+                                                        scene_sphere_x.data() + first,
+                                                        scene_sphere_y.data() + first,
+                                                        scene_sphere_z.data() + first,
+                                                        scene_sphere_radius.data() + first,
+                                                        last - first,
+                                                        scene_objects_visible.data() + first);
+                            });
+}
+
+//CPU side of the cull shader: packs the visible objects of every batch into the
+//image instance buffer and counts them. The image must not be in flight.
+void Vulkan::write_visible_instances(uint32_t current_image)
+{
+    uint32_t* ptr_instances = static_cast<uint32_t*>(instance_buffers_mapped[current_image]);
+
+    scene_batches_visible_count.assign(scene_batches.size(), 0);
+
+    for(uint32_t object = 0; object < scene_objects.size(); object++)
+    {
+        if(scene_objects_visible[object])
+        {
+            uint32_t b = scene_objects[object].batch;
+            ptr_instances[scene_batches[b].draw.firstInstance + scene_batches_visible_count[b]++] = object;
+        }
+    }
+}
+
+//CPU side of the level of detail pick of the cull shader, for the visible objects: the coarsest
+//level whose simplification error stays under LOD_PIXEL_ERROR pixels on screen. Coarser levels
+//only get picked once they are well under it, so objects sitting on the threshold do not pop
+//back and forth. pixels_per_unit is the screen size of one unit at clip space w 1.
+//Only write_visible_instances reads the level, the object buffer is left alone.
+void Vulkan::select_scene_lods(const Matrix4f& view_proj, float pixels_per_unit)
+{
+    for(uint32_t object = 0; object < scene_objects.size(); object++)
+    {
+        if(!scene_objects_visible[object])
+        {
+            continue;
+        }
+
+        const VulkanBatch& batch = scene_batches[scene_objects[object].batch];
+
+        if(batch.lod_count == 1)
+        {
+            continue;
+        }
+
+        const VulkanBatch* ptr_lods = &batch - batch.lod;
+
+        float w =   view_proj.get(0, 3) * scene_sphere_x[object] +
+                    view_proj.get(1, 3) * scene_sphere_y[object] +
+                    view_proj.get(2, 3) * scene_sphere_z[object] +
+                    view_proj.get(3, 3);
+
+        //Pixels per unit of lod_error at this distance, up close everything is full detail.
+        float scale = w > scene_sphere_radius[object] ? scene_sphere_radius[object] * pixels_per_unit / w : FLT_MAX;
+
+        uint32_t lod = batch.lod;
+
+        while(lod > 0 && ptr_lods[lod].lod_error * scale > LOD_PIXEL_ERROR)
+        {
+            lod--;
+        }
+
+        while(lod + 1 < batch.lod_count && ptr_lods[lod + 1].lod_error * scale <= LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+        {
+            lod++;
+        }
+
+        if(lod != batch.lod)
+        {
+            scene_objects[object].batch += lod - batch.lod;
+            scene.lods[scene_objects[object].object] = lod;
+        }
+    }
+}
+
+//Orders the batches by draw sort key for the camera in view_proj. Opaque groups go by
+//their nearest object, transparent ones by their furthest, depth being the clip space w,
+//and every level of detail batch of a group gets the key of the group, whichever level
+//its objects are at. Transparent objects have a group each and are keyed every frame.
+//Front to back only saves fill, so opaque groups keep their keys until the batches change
+//rather than walking every object each frame.
+void Vulkan::sort_scene_batches(const Matrix4f& view_proj)
+{
+    uint32_t batch_count = scene_batches.size();
+
+    bool opaque_stale = scene_draw_keys_stale || scene_draw_keys.size() != batch_count;
+    scene_draw_keys_stale = false;
+
+    scene_draw_keys.resize(batch_count);
+
+    //The batches of a group follow each other from level 0.
+    for(uint32_t b = 0; b < batch_count; b += scene_batches[b].lod_count)
+    {
+        uint32_t first = scene_batches[b].first_object;
+        uint32_t end = first + scene_batches[b].object_count;
+        bool transparent = scene_batches[b].transparent;
+
+        if(!transparent && !opaque_stale)
+        {
+            continue;
+        }
+
+        float depth = transparent ? -FLT_MAX : FLT_MAX;
+
+        for(uint32_t object = first; object < end; object++)
+        {
+            float w =   view_proj.get(0, 3) * scene_sphere_x[object] +
+                        view_proj.get(1, 3) * scene_sphere_y[object] +
+                        view_proj.get(2, 3) * scene_sphere_z[object] +
+                        view_proj.get(3, 3);
+
+            depth = transparent ? std::max(depth, w + scene_sphere_radius[object]) : std::min(depth, w - scene_sphere_radius[object]);
+        }
+
+        for(uint32_t l = 0; l < scene_batches[b].lod_count; l++)
+        {
+            scene_draw_keys[b + l] = get_draw_sort_key(transparent, depth, b + l);
+        }
+    }
+
+    uint32_t* ptr_order = frame_arenas[current_frame]->allocate_array<uint32_t>(batch_count);
+
+    for(uint32_t b = 0; b < batch_count; b++)
+    {
+        ptr_order[b] = b;
+    }
+
+    std::sort(ptr_order, ptr_order + batch_count, [this](uint32_t a, uint32_t b)
+    {
+        return scene_draw_keys[a] < scene_draw_keys[b];
+    });
+
+    if( scene_draw_order.size() != batch_count ||
+        !std::equal(ptr_order, ptr_order + batch_count, scene_draw_order.begin()))
+    {
+        scene_draw_order.assign(ptr_order, ptr_order + batch_count);
+        scene_draw_order_generation++;
+    }
+}
+
+//Queues every entity sprite for this frame.
+void Vulkan::queue_entity_sprites(EntityStore& entity_store)
+{
+    entity_store.for_each<SpriteComponent>([&](size_t count, SpriteComponent* ptr_sprites)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            sprite_queue.queue_sprite(  VulkanSprite(   ptr_sprites[i].ptr_texture,
+                                                        ptr_sprites[i].source,
+                                                        ptr_sprites[i].destination),
+                                        ptr_sprites[i].layer);
+        }
+    });
+}
+
+//Copies entity transforms into their scene objects, only the ones that moved touch the scene.
+void Vulkan::update_entity_meshes(EntityStore& entity_store)
+{
+    entity_store.for_each<TransformComponent, MeshComponent>([&](size_t count, TransformComponent* ptr_transforms, MeshComponent* ptr_meshes)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            uint32_t object = ptr_meshes[i].scene_object;
+
+            if(memcmp(&scene.transforms[object], &ptr_transforms[i].transform, sizeof(Affine3f)) != 0)
+            {
+                scene.move_object(object, ptr_transforms[i].transform);
+            }
+        }
+    });
+}
+
+//Brings the image object buffer up to date with the scene, growing it if needed.
+//The image must not be in flight.
+void Vulkan::update_object_buffer(uint32_t current_image)
+{
+    if(scene_objects_generation != get_scene_generation())
+    {
+        //The regather starts every object from the level it was last culled at.
+        if(gpu_culling_supported && command_buffers_start_generation[current_image] == scene_objects_generation)
+        {
+            read_scene_lods(current_image);
+        }
+
+        scene.gather_objects(scene_objects, scene_batches);
+        scene_objects_generation = get_scene_generation();
+        scene_draw_keys_stale = true;
+
+        scene_object_slots.assign(scene.size(), UINT32_MAX);
+
+        for(uint32_t i = 0; i < scene_objects.size(); i++)
+        {
+            scene_object_slots[scene_objects[i].object] = i;
+        }
+
+        size_t object_count = scene_objects.size();
+
+        scene_sphere_x.resize(object_count);
+        scene_sphere_y.resize(object_count);
+        scene_sphere_z.resize(object_count);
+        scene_sphere_radius.resize(object_count);
+        scene_objects_visible.assign(object_count, 1);
+
+        for(size_t i = 0; i < object_count; i++)
+        {
+            scene_sphere_x[i] = scene_objects[i].bounding_sphere.x();
+            scene_sphere_y[i] = scene_objects[i].bounding_sphere.y();
+            scene_sphere_z[i] = scene_objects[i].bounding_sphere.z();
+            scene_sphere_radius[i] = scene_objects[i].bounding_sphere.w();
+        }
+    }
+
+    if(scene_objects.size() > object_buffers_capacity[current_image])
+    {
+        uint32_t capacity = std::max<size_t>(scene_objects.size(), object_buffers_capacity[current_image] * 2);
+
+        destroy_object_buffer(current_image);
+        create_object_buffer(current_image, capacity);
+        write_object_descriptors(current_image);
+    }
+
+    memcpy(object_buffers_mapped[current_image], scene_objects.data(), scene_objects.size() * sizeof(VulkanObjectData));
+    object_buffers_moved[current_image].clear();
+
+    if(gpu_culling_supported)
+    {
+        std::vector<VulkanDrawCommand> templates(scene_batches.size());
+
+        for(size_t b = 0; b < scene_batches.size(); b++)
+        {
+            templates[b].draw = scene_batches[b].draw;
+            templates[b].draw.instanceCount = 0;
+            templates[b].lod = scene_batches[b].lod;
+            templates[b].lod_count = scene_batches[b].lod_count;
+            templates[b].lod_error = scene_batches[b].lod_error;
+        }
+
+        memcpy(batch_buffers_mapped[current_image], templates.data(), templates.size() * sizeof(VulkanDrawCommand));
+    }
+    else
+    {
+        write_visible_instances(current_image);
+    }
+}
+
+//Takes the levels the cull shader last picked in the image object buffer into the scene.
+//The buffer has to hold the current gather and the image must not be in flight.
+void Vulkan::read_scene_lods(uint32_t current_image)
+{
+    const VulkanObjectData* ptr_objects = static_cast<const VulkanObjectData*>(object_buffers_mapped[current_image]);
+
+    for(uint32_t slot = 0; slot < scene_objects.size(); slot++)
+    {
+        uint32_t batch = ptr_objects[slot].batch;
+
+        if(batch < scene_batches.size())
+        {
+            scene.lods[scene_objects[slot].object] = scene_batches[batch].lod;
+        }
+    }
+}
+
+//Patches the objects moved since the last frame into scene_objects, and every object moved
+//since the image object buffer was last written into that buffer, keeping the level the cull
+//shader picked for it. The image must not be in flight.
+void Vulkan::patch_moved_objects(uint32_t current_image)
+{
+    for(uint32_t object : scene.moved_objects)
+    {
+        uint32_t slot = object < scene_object_slots.size() ? scene_object_slots[object] : UINT32_MAX;
+
+        if(slot == UINT32_MAX)
+        {
+            continue;
+        }
 
-    exec_copy_buffer_cmd(staging_buffer, index_buffer, buffer_size);
+        scene.update_object_data(object, scene_objects[slot]);
 
-    vkDestroyBuffer(logical_device, staging_buffer, nullptr);
-    vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+        scene_sphere_x[slot] = scene_objects[slot].bounding_sphere.x();
+        scene_sphere_y[slot] = scene_objects[slot].bounding_sphere.y();
+        scene_sphere_z[slot] = scene_objects[slot].bounding_sphere.z();
+        scene_sphere_radius[slot] = scene_objects[slot].bounding_sphere.w();
+
+        for(std::vector<uint32_t>& moved : object_buffers_moved)
+        {
+            moved.push_back(slot);
+        }
+    }
+
+    scene.moved_objects.clear();
+
+    std::vector<uint32_t>& moved = object_buffers_moved[current_image];
+    VulkanObjectData* ptr_objects = static_cast<VulkanObjectData*>(object_buffers_mapped[current_image]);
+
+    auto patch = [&](uint32_t slot)
+    {
+        uint32_t batch = ptr_objects[slot].batch;
+        ptr_objects[slot] = scene_objects[slot];
+        ptr_objects[slot].batch = batch;
+    };
+
+    //Past a point going through every slot once beats going through the duplicates.
+    if(moved.size() >= scene_objects.size())
+    {
+        for(uint32_t slot = 0; slot < scene_objects.size(); slot++)
+        {
+            patch(slot);
+        }
+    }
+    else
+    {
+        for(uint32_t slot : moved)
+        {
+            patch(slot);
+        }
+    }
+
+    moved.clear();
 }
 
 //Creates the Index buffer.
@@ -135,6 +592,10 @@ void Vulkan::create_render_command_buffers()
     command_buffers_start.resize(render_target_framebuffers.size());
     command_buffers_dynamic.resize(render_target_framebuffers.size());
     command_buffers_end.resize(render_target_framebuffers.size());
+    command_buffers_start_generation.resize(render_target_framebuffers.size());
+    command_buffers_start_draw_order.resize(render_target_framebuffers.size());
+    command_buffers_dynamic_hash.assign(render_target_framebuffers.size(), 0);
+    command_buffers_dynamic_reusable.assign(render_target_framebuffers.size(), 0);
 
     VkCommandBufferAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -152,10 +613,19 @@ void Vulkan::create_render_command_buffers()
         throw std::runtime_error("Failed to allocate command buffers.");
     }
 
+    //Recorded every frame that changes the sprites, the pool lets them be begun again.
+    if (vkAllocateCommandBuffers(logical_device, &allocInfo, command_buffers_dynamic.data()) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to allocate command buffers.");
+    }
+
     for (size_t i = 0; i < render_target_framebuffers.size(); i++) 
     {
+        update_object_buffer(i);
         start_render_cmd(i);
         end_render_cmd(i);
+        command_buffers_start_generation[i] = get_scene_generation();
+        command_buffers_start_draw_order[i] = scene_draw_order_generation;
     }
 }
 
@@ -174,6 +644,72 @@ void Vulkan::start_render_cmd(uint32_t current_framebuffer)
         throw std::runtime_error("Failed to begin recording command buffer.");
     }
 
+    uint32_t object_count = scene_objects.size();
+    uint32_t batch_count = scene_batches.size();
+    bool gpu_culling = gpu_culling_supported && object_count > 0;
+
+    //Resets every batch to zero instances, then the cull shader appends the visible objects.
+    if(gpu_culling)
+    {
+        VkBufferCopy copy_region = {};
+        copy_region.size = batch_count * sizeof(VulkanDrawCommand);
+        vkCmdCopyBuffer(command_buffers_start[current_framebuffer], batch_buffers[current_framebuffer], indirect_buffers[current_framebuffer], 1, &copy_region);
+
+        VkBufferMemoryBarrier reset_barrier = {};
+        reset_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        reset_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        reset_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        reset_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        reset_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        reset_barrier.buffer = indirect_buffers[current_framebuffer];
+        reset_barrier.offset = 0;
+        reset_barrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(   command_buffers_start[current_framebuffer],
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                0,
+                                0, nullptr,
+                                1, &reset_barrier,
+                                0, nullptr);
+
+        vkCmdBindPipeline(command_buffers_start[current_framebuffer], VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline);
+        vkCmdBindDescriptorSets(command_buffers_start[current_framebuffer], VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout, 0, 1, &descriptor_sets[current_framebuffer], 0, nullptr);
+        CullConstants cull_constants = {};
+        cull_constants.object_count = object_count;
+        cull_constants.half_target_height = HEIGHT * 0.5f;
+        cull_constants.lod_pixel_error = LOD_PIXEL_ERROR;
+        cull_constants.lod_hysteresis = LOD_HYSTERESIS;
+
+        vkCmdPushConstants(command_buffers_start[current_framebuffer], cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &cull_constants);
+        vkCmdDispatch(command_buffers_start[current_framebuffer], (object_count + 63) / 64, 1, 1);
+
+        std::array<VkBufferMemoryBarrier, 3> barriers = {};
+        barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].buffer = indirect_buffers[current_framebuffer];
+        barriers[0].offset = 0;
+        barriers[0].size = VK_WHOLE_SIZE;
+
+        barriers[1] = barriers[0];
+        barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[1].buffer = instance_buffers[current_framebuffer];
+
+        //The levels written back are read by the CPU once the frame is done.
+        barriers[2] = barriers[0];
+        barriers[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        barriers[2].buffer = object_buffers[current_framebuffer];
+
+        vkCmdPipelineBarrier(   command_buffers_start[current_framebuffer],
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                                0,
+                                0, nullptr,
+                                static_cast<uint32_t>(barriers.size()), barriers.data(),
+                                0, nullptr);
+    }
+
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = render_pass;
@@ -181,9 +717,11 @@ void Vulkan::start_render_cmd(uint32_t current_framebuffer)
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = render_target_image_extent;
 
-    VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    std::array<VkClearValue, 2> clear_values = {};
+    clear_values[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+    clear_values[1].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clear_values.size());
+    renderPassInfo.pClearValues = clear_values.data();
 
 
 
@@ -191,13 +729,63 @@ void Vulkan::start_render_cmd(uint32_t current_framebuffer)
     vkCmdBeginRenderPass(command_buffers_start[current_framebuffer], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBindPipeline(command_buffers_start[current_framebuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
         
-        VkBuffer vertex_buffers[] = {vertex_buffer};
+        VkBuffer vertex_buffers[] = {mesh_pool->vertex_buffer};
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(command_buffers_start[current_framebuffer], 0, 1, vertex_buffers, offsets);
-        vkCmdBindIndexBuffer(command_buffers_start[current_framebuffer], index_buffer, 0, VK_INDEX_TYPE_UINT32);
         vkCmdBindDescriptorSets(command_buffers_start[current_framebuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_sets[current_framebuffer], 0, nullptr);
-        
-        vkCmdDrawIndexed(command_buffers_start[current_framebuffer], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+
+        //Batches in sort key order, opaque front to back then transparent back to front.
+        //Neighbours in both the order and the indirect buffer go out as one multi draw.
+        VkPipeline bound_pipeline = graphics_pipeline;
+        VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+
+        for(uint32_t d = 0; d < scene_draw_order.size();)
+        {
+            const VulkanBatch& batch = scene_batches[scene_draw_order[d]];
+            VkPipeline pipeline = batch.transparent ? transparent_pipeline : graphics_pipeline;
+
+            if(pipeline != bound_pipeline)
+            {
+                vkCmdBindPipeline(command_buffers_start[current_framebuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                bound_pipeline = pipeline;
+            }
+
+            if(batch.index_type != bound_index_type)
+            {
+                vkCmdBindIndexBuffer(command_buffers_start[current_framebuffer], mesh_pool->index_buffer, 0, batch.index_type);
+                bound_index_type = batch.index_type;
+            }
+
+            uint32_t run = 1;
+
+            while(  gpu_culling && run < max_draw_indirect_count && d + run < scene_draw_order.size() &&
+                    scene_draw_order[d + run] == scene_draw_order[d] + run &&
+                    scene_batches[scene_draw_order[d + run]].transparent == batch.transparent &&
+                    scene_batches[scene_draw_order[d + run]].index_type == batch.index_type)
+            {
+                run++;
+            }
+
+            if(gpu_culling)
+            {
+                vkCmdDrawIndexedIndirect(   command_buffers_start[current_framebuffer],
+                                            indirect_buffers[current_framebuffer],
+                                            scene_draw_order[d] * sizeof(VulkanDrawCommand),
+                                            run,
+                                            sizeof(VulkanDrawCommand));
+            }
+            else if(scene_batches_visible_count[scene_draw_order[d]] > 0)
+            {
+                vkCmdDrawIndexed(   command_buffers_start[current_framebuffer],
+                                    batch.draw.indexCount,
+                                    scene_batches_visible_count[scene_draw_order[d]],
+                                    batch.draw.firstIndex,
+                                    batch.draw.vertexOffset,
+                                    batch.draw.firstInstance);
+            }
+
+            d += run;
+        }
    vkCmdEndRenderPass(command_buffers_start[current_framebuffer]);
 
     transition_image_layout_cmd(    command_buffers_start[current_framebuffer],
@@ -273,50 +861,332 @@ void Vulkan::end_render_cmd(uint32_t current_framebuffer)
     }
 }
 
+//Moves a source range along with its destination range being clipped to [clip_0, clip_1),
+//rounding outwards. Exact for unscaled ranges.
+static void clip_blit_range(int32_t& src_0, int32_t& src_1,
+                            int32_t dst_0, int32_t dst_1,
+                            int32_t clip_0, int32_t clip_1)
+{
+    int64_t src_size = src_1 - src_0;
+    int64_t dst_size = dst_1 - dst_0;
+
+    int32_t new_0 = src_0 + static_cast<int32_t>(int64_t(clip_0 - dst_0) * src_size / dst_size);
+    int32_t new_1 = src_0 + static_cast<int32_t>((int64_t(clip_1 - dst_0) * src_size + dst_size - 1) / dst_size);
+
+    src_0 = new_0;
+    src_1 = std::max(new_1, new_0 + 1);
+}
+
 //Holds the instructions executed every loop of the renderer.
-VkCommandBuffer Vulkan::dynamic_render_cmd(uint32_t current_framebuffer)
+void Vulkan::dynamic_render_cmd(uint32_t current_framebuffer)
 {
-    VkCommandBuffer dynamic_instructions = begin_one_time_commands();
-    
-    for(auto layer_vector : sprite_queue.queue)
+    VkCommandBuffer dynamic_instructions = command_buffers_dynamic[current_framebuffer];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    //Not one time, an unchanged queue submits it again.
+    if (vkBeginCommandBuffer(dynamic_instructions, &beginInfo) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to begin recording command buffer.");
+    }
+
+    layer_cache->record_redraws(dynamic_instructions);
+
+    if(overdraw.heatmap)
+    {
+        VkBufferImageCopy heatmap_copy = {};
+        heatmap_copy.imageSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+        heatmap_copy.imageExtent = {render_target_image_extent.width, render_target_image_extent.height, 1};
+
+        vkCmdCopyBufferToImage( dynamic_instructions,
+                                heatmap_buffers[current_framebuffer],
+                                render_target_images[current_framebuffer],
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                1,
+                                &heatmap_copy);
+    }
+    else
+    {
+        VkRect2D target = {{0, 0}, render_target_image_extent};
+
+        record_sprite_cmds( dynamic_instructions,
+                            render_target_images[current_framebuffer], render_target_image_format,
+                            sprite_queue.ptr_sprites, sprite_queue.ptr_keys, sprite_queue.count,
+                            {0, 0},
+                            &target, 1);
+    }
+
+    //End the GPU instructions.
+    if (vkEndCommandBuffer(dynamic_instructions) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to record command buffer.");
+    }
+}
+
+//The whole frame of a purely 2D image, in place of the start, dynamic and end buffers.
+//Only the damaged rects are cleared, have their sprites drawn and get upscaled to the
+//swapchain image, the rest of both images still holds the same pixels from the last time.
+//Without damage it's empty, the image is presented as is.
+void Vulkan::damage_render_cmd(uint32_t current_framebuffer, const VulkanDamage& damage)
+{
+    VkCommandBuffer damage_instructions = command_buffers_dynamic[current_framebuffer];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(damage_instructions, &beginInfo) != VK_SUCCESS) 
     {
-        for(auto sprite : layer_vector)
+        throw std::runtime_error("Failed to begin recording command buffer.");
+    }
+
+    layer_cache->record_redraws(damage_instructions);
+
+    if(damage.count > 0)
+    {
+        transition_image_layout_cmd(    damage_instructions,
+                                        render_target_images[current_framebuffer], 
+                                        swap_chain_image_format, 
+                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        VkBufferImageCopy clears[DAMAGE_MAX_RECTS] = {};
+        VkImageBlit upscales[DAMAGE_MAX_RECTS] = {};
+
+        int32_t scale_x = static_cast<int32_t>(swap_chain_image_extent.width / render_target_image_extent.width);
+        int32_t scale_y = static_cast<int32_t>(swap_chain_image_extent.height / render_target_image_extent.height);
+
+        for(uint32_t i = 0; i < damage.count; i++)
         {
-            VkImageBlit image_blit = {};
-            image_blit.srcSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
-            image_blit.srcOffsets[0] = {sprite->source.offset.x, 
-                                        sprite->source.offset.y, 
-                                        0};
-            image_blit.srcOffsets[1] = {static_cast<int32_t>(sprite->source.extent.width + sprite->source.offset.x), 
-                                        static_cast<int32_t>(sprite->source.extent.height + sprite->source.offset.y), 
-                                        1};
+            const VkRect2D& rect = damage.rects[i];
+            int32_t x1 = rect.offset.x + static_cast<int32_t>(rect.extent.width);
+            int32_t y1 = rect.offset.y + static_cast<int32_t>(rect.extent.height);
+
+            clears[i].bufferOffset = (VkDeviceSize(rect.offset.y) * render_target_image_extent.width + rect.offset.x) * 4;
+            clears[i].bufferRowLength = render_target_image_extent.width;
+            clears[i].imageSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+            clears[i].imageOffset = {rect.offset.x, rect.offset.y, 0};
+            clears[i].imageExtent = {rect.extent.width, rect.extent.height, 1};
+
+            upscales[i].srcSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+            upscales[i].srcOffsets[0] = {rect.offset.x, rect.offset.y, 0};
+            upscales[i].srcOffsets[1] = {x1, y1, 1};
+            upscales[i].dstSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+            upscales[i].dstOffsets[0] = {rect.offset.x * scale_x, rect.offset.y * scale_y, 0};
+            upscales[i].dstOffsets[1] = {x1 * scale_x, y1 * scale_y, 1};
+        }
 
-            image_blit.dstSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
-            image_blit.dstOffsets[0] = {sprite->destination.offset.x, 
-                                        sprite->destination.offset.y, 
-                                        0};
-            image_blit.dstOffsets[1] = {static_cast<int32_t>(sprite->destination.extent.width + sprite->destination.offset.x), 
-                                        static_cast<int32_t>(sprite->destination.extent.height + sprite->destination.offset.y), 
-                                        1};
-            //Queues the actual blitting.
-            vkCmdBlitImage( dynamic_instructions, 
-                            sprite->ptr_texture->image,
+        vkCmdCopyBufferToImage( damage_instructions,
+                                damage_clear_buffer,
+                                render_target_images[current_framebuffer],
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                damage.count,
+                                clears);
+
+        //The sprites go over the cleared rects.
+        VkMemoryBarrier clear_barrier = {};
+        clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clear_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(   damage_instructions,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                0,
+                                1, &clear_barrier,
+                                0, nullptr,
+                                0, nullptr);
+
+        record_sprite_cmds( damage_instructions,
+                            render_target_images[current_framebuffer], render_target_image_format,
+                            sprite_queue.ptr_sprites, sprite_queue.ptr_keys, sprite_queue.count,
+                            {0, 0},
+                            damage.rects, damage.count);
+
+        transition_image_layout_cmd(    damage_instructions,
+                                        render_target_images[current_framebuffer], 
+                                        swap_chain_image_format, 
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        transition_image_layout_cmd(    damage_instructions,
+                                        swap_chain_images[current_framebuffer], 
+                                        swap_chain_image_format, 
+                                        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        //Whole scale factors map every rect to exactly the pixels the full upscale gives it.
+        vkCmdBlitImage( damage_instructions, 
+                        render_target_images[current_framebuffer],
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        swap_chain_images[current_framebuffer],
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        damage.count,
+                        upscales,
+                        VK_FILTER_NEAREST);
+
+        transition_image_layout_cmd(    damage_instructions,
+                                        swap_chain_images[current_framebuffer], 
+                                        swap_chain_image_format, 
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    }
+
+    if (vkEndCommandBuffer(damage_instructions) != VK_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to record command buffer.");
+    }
+}
+
+//Walks the keys in order, sprites of a texture follow each other.
+void Vulkan::record_sprite_cmds(VkCommandBuffer command_buffer,
+                                VkImage target, VkFormat target_format,
+                                const VulkanSprite* ptr_sprites,
+                                const uint64_t* ptr_keys, uint32_t key_count,
+                                VkOffset2D origin,
+                                const VkRect2D* ptr_clips, uint32_t clip_count)
+{
+    //Consecutive sprites of a texture go out as a single command with a region each,
+    //a copy when they are unscaled and the formats match, a blit otherwise.
+    //Regions of a command are not ordered, so a sprite overlapping the batch starts a new one.
+    VkImageBlit* ptr_blits = frame_arenas[current_frame]->allocate_array<VkImageBlit>(key_count);
+    VkImageCopy* ptr_copies = frame_arenas[current_frame]->allocate_array<VkImageCopy>(key_count);
+
+    VulkanTexture* ptr_batch_texture = nullptr;
+    VkFilter batch_filter = VK_FILTER_NEAREST;
+    bool batch_copy = false;
+    uint32_t batch_count = 0;
+    int32_t batch_x0 = 0, batch_y0 = 0, batch_x1 = 0, batch_y1 = 0;
+
+    auto flush_batch = [&]()
+    {
+        if(batch_count == 0)
+        {
+            return;
+        }
+
+        if(batch_copy)
+        {
+            vkCmdCopyImage( command_buffer,
+                            ptr_batch_texture->image,
                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                            render_target_images[current_framebuffer],
+                            target,
                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            1,
-                            &image_blit,
-                            VK_FILTER_NEAREST);
+                            batch_count,
+                            ptr_copies);
+        }
+        else
+        {
+            vkCmdBlitImage( command_buffer, 
+                            ptr_batch_texture->image,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            target,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            batch_count,
+                            ptr_blits,
+                            batch_filter);
         }
-    }   
 
-    //End the GPU instructions.
-    if (vkEndCommandBuffer(dynamic_instructions) != VK_SUCCESS) 
+        batch_count = 0;
+    };
+
+    for(uint32_t c = 0; c < clip_count; c++)
     {
-        throw std::runtime_error("Failed to record command buffer.");
+        int32_t rect_x0 = ptr_clips[c].offset.x;
+        int32_t rect_y0 = ptr_clips[c].offset.y;
+        int32_t rect_x1 = rect_x0 + static_cast<int32_t>(ptr_clips[c].extent.width);
+        int32_t rect_y1 = rect_y0 + static_cast<int32_t>(ptr_clips[c].extent.height);
+
+        for(uint32_t i = 0; i < key_count; i++)
+        {
+            const VulkanSprite& sprite = ptr_sprites[ptr_keys[i] & SPRITE_KEY_INDEX_MASK];
+
+            int32_t dst_x0 = sprite.destination.offset.x - origin.x;
+            int32_t dst_y0 = sprite.destination.offset.y - origin.y;
+            int32_t dst_x1 = dst_x0 + static_cast<int32_t>(sprite.destination.extent.width);
+            int32_t dst_y1 = dst_y0 + static_cast<int32_t>(sprite.destination.extent.height);
+
+            //Sprites outside the clip rect and empty ones are dropped, the rest are clipped to it.
+            int32_t clip_x0 = std::max(dst_x0, rect_x0);
+            int32_t clip_y0 = std::max(dst_y0, rect_y0);
+            int32_t clip_x1 = std::min(dst_x1, rect_x1);
+            int32_t clip_y1 = std::min(dst_y1, rect_y1);
+
+            if( clip_x0 >= clip_x1 || clip_y0 >= clip_y1 ||
+                sprite.source.extent.width == 0 || sprite.source.extent.height == 0)
+            {
+                continue;
+            }
+
+            uint32_t mip_level = get_sprite_mip_level(sprite);
+
+            int32_t src_x0 = sprite.source.offset.x >> mip_level;
+            int32_t src_y0 = sprite.source.offset.y >> mip_level;
+            int32_t src_x1 = static_cast<int32_t>(sprite.source.extent.width + sprite.source.offset.x) >> mip_level;
+            int32_t src_y1 = static_cast<int32_t>(sprite.source.extent.height + sprite.source.offset.y) >> mip_level;
+
+            bool copy = src_x1 - src_x0 == dst_x1 - dst_x0 &&
+                        src_y1 - src_y0 == dst_y1 - dst_y0 &&
+                        sprite.ptr_texture->image_format == target_format;
+
+            clip_blit_range(src_x0, src_x1, dst_x0, dst_x1, clip_x0, clip_x1);
+            clip_blit_range(src_y0, src_y1, dst_y0, dst_y1, clip_y0, clip_y1);
+
+            VkFilter filter = sprite.pixel_perfect ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+
+            bool overlaps = clip_x0 < batch_x1 && batch_x0 < clip_x1 && clip_y0 < batch_y1 && batch_y0 < clip_y1;
+
+            if( batch_count == 0 || overlaps ||
+                sprite.ptr_texture != ptr_batch_texture || copy != batch_copy ||
+                (!copy && filter != batch_filter))
+            {
+                flush_batch();
+
+                ptr_batch_texture = sprite.ptr_texture;
+                batch_filter = filter;
+                batch_copy = copy;
+                batch_x0 = clip_x0;
+                batch_y0 = clip_y0;
+                batch_x1 = clip_x1;
+                batch_y1 = clip_y1;
+            }
+            else
+            {
+                batch_x0 = std::min(batch_x0, clip_x0);
+                batch_y0 = std::min(batch_y0, clip_y0);
+                batch_x1 = std::max(batch_x1, clip_x1);
+                batch_y1 = std::max(batch_y1, clip_y1);
+            }
+
+            if(copy)
+            {
+                VkImageCopy& image_copy = ptr_copies[batch_count++];
+                image_copy = {};
+                image_copy.srcSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+                image_copy.srcSubresource.mipLevel = mip_level;
+                image_copy.srcOffset = {src_x0, src_y0, 0};
+                image_copy.dstSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+                image_copy.dstOffset = {clip_x0, clip_y0, 0};
+                image_copy.extent = {   static_cast<uint32_t>(clip_x1 - clip_x0),
+                                        static_cast<uint32_t>(clip_y1 - clip_y0),
+                                        1};
+            }
+            else
+            {
+                VkImageBlit& image_blit = ptr_blits[batch_count++];
+                image_blit = {};
+                image_blit.srcSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+                image_blit.srcSubresource.mipLevel = mip_level;
+                image_blit.srcOffsets[0] = {src_x0, src_y0, 0};
+                image_blit.srcOffsets[1] = {src_x1, src_y1, 1};
+                image_blit.dstSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+                image_blit.dstOffsets[0] = {clip_x0, clip_y0, 0};
+                image_blit.dstOffsets[1] = {clip_x1, clip_y1, 1};
+            }
+        }
+
+        flush_batch();
     }
-    
-    return dynamic_instructions;
 }
 
 //ONE-TIME COMMANDS
@@ -400,12 +1270,28 @@ void Vulkan::exec_copy_buffer_to_image_cmd( VkBuffer buffer, VkImage image,
     end_one_time_commands(command_buffer);
 }
 
+void Vulkan::exec_copy_buffer_to_image_cmd( VkBuffer buffer, VkImage image, 
+                                            const std::vector<VkBufferImageCopy>& regions)
+{
+    VkCommandBuffer command_buffer = begin_one_time_commands();
+
+    vkCmdCopyBufferToImage( command_buffer, 
+                            buffer, 
+                            image, 
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            static_cast<uint32_t>(regions.size()),
+                            regions.data());
+
+    end_one_time_commands(command_buffer);
+}
+
 
 //Issues a transition image layout cmd to the command buffer.
 void Vulkan::transition_image_layout_cmd(   VkCommandBuffer command_buffer,
                                             VkImage image, VkFormat format, 
                                             VkImageLayout old_layout,
-                                            VkImageLayout new_layout)
+                                            VkImageLayout new_layout,
+                                            uint32_t mip_levels)
 {
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -419,7 +1305,7 @@ void Vulkan::transition_image_layout_cmd(   VkCommandBuffer command_buffer,
 
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mip_levels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -466,6 +1352,15 @@ void Vulkan::transition_image_layout_cmd(   VkCommandBuffer command_buffer,
         source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if(old_layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+    {
+        //Keeps the contents, the submit waits for the image at the transfer stage.
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
     else if(old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
     {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
@@ -491,11 +1386,12 @@ void Vulkan::transition_image_layout_cmd(   VkCommandBuffer command_buffer,
 //Executes a transition image layout cmd to the command buffer.
 void Vulkan::exec_transition_image_layout_cmd(  VkImage image, VkFormat format, 
                                                 VkImageLayout old_layout,
-                                                VkImageLayout new_layout)
+                                                VkImageLayout new_layout,
+                                                uint32_t mip_levels)
 {
     VkCommandBuffer command_buffer = begin_one_time_commands();
 
-    transition_image_layout_cmd(command_buffer, image, format, old_layout, new_layout);
+    transition_image_layout_cmd(command_buffer, image, format, old_layout, new_layout, mip_levels);
 
     end_one_time_commands(command_buffer);
 }
@@ -568,6 +1464,8 @@ void Vulkan::cpu_draw_frames(uint32_t current_framebuffer)
                 0);
 
 
+    queue_entity_sprites(entities);
+
     update_uniform_buffer(current_framebuffer);
 }
 
@@ -576,7 +1474,7 @@ void Vulkan::draw_frames()
 {
     //Waits for the fence for the current framebuffer to be signaled
     vkWaitForFences(logical_device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX);
-    
+
     //Gets the next image in the swapbuffer, the one we'll be rendering to.
     uint32_t imageIndex;
     vkAcquireNextImageKHR(logical_device, swap_chain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &imageIndex);
@@ -587,7 +1485,21 @@ void Vulkan::draw_frames()
         vkWaitForFences(logical_device, 1, &images_in_flight[imageIndex], VK_TRUE, UINT64_MAX);
     }
 
-    vkFreeCommandBuffers(logical_device, command_pool, 1, &command_buffers_dynamic[imageIndex]);
+    //Picks up moved nodes and finished loads, the start buffer is re-recorded once this image is free.
+    hierarchy.update();
+    scene.update_transforms(hierarchy);
+    update_entity_meshes(entities);
+    mesh_pool->update();
+    texture_streamer->update();
+    texture_cache->update();
+    text_runs.update();
+
+    if(command_buffers_start_generation[imageIndex] != get_scene_generation())
+    {
+        update_object_buffer(imageIndex);
+    }
+
+    patch_moved_objects(imageIndex);
 
     // Mark the image as now being in use by this frame
     images_in_flight[imageIndex] = in_flight_fences[current_frame];
@@ -597,30 +1509,85 @@ void Vulkan::draw_frames()
 
     cpu_draw_frames(imageIndex);
 
-    //Queues the start section of the rendering part. Waits for the image Available semaphore
-    queue_submit(   graphics_queue,
-                    &command_buffers_start[imageIndex],
-                    image_available_semaphores[current_frame], 
-                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    render_start_finished_semaphores[current_frame],
-                    VK_NULL_HANDLE);
-
-    command_buffers_dynamic[imageIndex] = dynamic_render_cmd(imageIndex);
-
-    queue_submit(   graphics_queue,
-                    &command_buffers_dynamic[imageIndex],
-                    render_start_finished_semaphores[current_frame],
-                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    render_dynamic_finished_semaphores[current_frame],
-                    VK_NULL_HANDLE);
-
-    //Queues the end section of the rendering part, waits for the dynamic part to finish, signals the render end section
-    queue_submit(   graphics_queue,
-                    &command_buffers_end[imageIndex],
-                    render_dynamic_finished_semaphores[current_frame],
-                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    render_end_finished_semaphores[current_frame],
-                    in_flight_fences[current_frame]);
+    //Without GPU culling the recorded draws follow the CPU cull of this frame,
+    //otherwise only a scene or draw order change needs them recorded again.
+    if( !gpu_culling_supported ||
+        command_buffers_start_generation[imageIndex] != get_scene_generation() ||
+        command_buffers_start_draw_order[imageIndex] != scene_draw_order_generation)
+    {
+        start_render_cmd(imageIndex);
+        command_buffers_start_generation[imageIndex] = get_scene_generation();
+        command_buffers_start_draw_order[imageIndex] = scene_draw_order_generation;
+    }
+
+    layer_cache->replace_layers(sprite_queue);
+    sprite_queue.sort();
+    sprite_queue.cull_hidden(render_target_image_extent);
+
+    overdraw.add_frame(sprite_queue, render_target_image_extent, render_target_image_format);
+
+    if(overdraw.heatmap)
+    {
+        overdraw.write_heatmap( static_cast<uint32_t*>(heatmap_buffers_mapped[imageIndex]),
+                                render_target_image_format == VK_FORMAT_B8G8R8A8_SRGB ||
+                                render_target_image_format == VK_FORMAT_B8G8R8A8_UNORM);
+    }
+
+    //The 3D pass redraws the whole target, only frames without it can be redrawn in part.
+    //The heatmap is copied over all of it.
+    damage_tracker.add_frame(sprite_queue, !partial_redraw_supported || !scene_batches.empty() || overdraw.heatmap);
+
+    VulkanDamage damage;
+    damage_tracker.take_image_damage(imageIndex, damage);
+
+    if(!damage.full)
+    {
+        damage_render_cmd(imageIndex, damage);
+        command_buffers_dynamic_reusable[imageIndex] = 0;
+
+        queue_submit(   graphics_queue,
+                        &command_buffers_dynamic[imageIndex],
+                        image_available_semaphores[current_frame], 
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        render_end_finished_semaphores[current_frame],
+                        in_flight_fences[current_frame]);
+    }
+    else
+    {
+        //Queues the start section of the rendering part. Waits for the image Available semaphore
+        queue_submit(   graphics_queue,
+                        &command_buffers_start[imageIndex],
+                        image_available_semaphores[current_frame], 
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        render_start_finished_semaphores[current_frame],
+                        VK_NULL_HANDLE);
+
+        //Same sprites as the last time this image was drawn in full, the recording still holds.
+        if( !command_buffers_dynamic_reusable[imageIndex] ||
+            command_buffers_dynamic_hash[imageIndex] != sprite_queue.hash ||
+            layer_cache->has_redraws())
+        {
+            //Layer redraws only have to run once, a buffer holding them isn't kept.
+            command_buffers_dynamic_reusable[imageIndex] = !layer_cache->has_redraws();
+            command_buffers_dynamic_hash[imageIndex] = sprite_queue.hash;
+            dynamic_render_cmd(imageIndex);
+        }
+
+        queue_submit(   graphics_queue,
+                        &command_buffers_dynamic[imageIndex],
+                        render_start_finished_semaphores[current_frame],
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        render_dynamic_finished_semaphores[current_frame],
+                        VK_NULL_HANDLE);
+
+        //Queues the end section of the rendering part, waits for the dynamic part to finish, signals the render end section
+        queue_submit(   graphics_queue,
+                        &command_buffers_end[imageIndex],
+                        render_dynamic_finished_semaphores[current_frame],
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        render_end_finished_semaphores[current_frame],
+                        in_flight_fences[current_frame]);
+    }
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -641,7 +1608,13 @@ void Vulkan::draw_frames()
 
     //std::cout << "FPS = " << get_FPS() << std::endl;
 
-    sprite_queue.clear_queue();   
+    sprite_queue.clear_queue();
+
+    //Sprites queued before the next draw_frames already go in the arena of the next frame.
+    //Only the CPU reads arena memory, the commands recorded from it hold copies, so it can
+    //be reset here without waiting for the fence of its frame.
+    frame_arenas[current_frame]->reset();
+    sprite_queue.ptr_arena = frame_arenas[current_frame];
 }
 
 /*
@@ -724,7 +1697,7 @@ void Vulkan::create_descriptor_set_layout()
     ubo_layout_binding.binding = 0;
     ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     ubo_layout_binding.descriptorCount = 1;
-    ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
     ubo_layout_binding.pImmutableSamplers = nullptr;
 
     VkDescriptorSetLayoutBinding sampler_layout_binding{};
@@ -734,7 +1707,30 @@ void Vulkan::create_descriptor_set_layout()
     sampler_layout_binding.pImmutableSamplers = nullptr;
     sampler_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {ubo_layout_binding, sampler_layout_binding};
+    VkDescriptorSetLayoutBinding object_layout_binding = {};
+    object_layout_binding.binding = 2;
+    object_layout_binding.descriptorCount = 1;
+    object_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    object_layout_binding.pImmutableSamplers = nullptr;
+    object_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding indirect_layout_binding = {};
+    indirect_layout_binding.binding = 3;
+    indirect_layout_binding.descriptorCount = 1;
+    indirect_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    indirect_layout_binding.pImmutableSamplers = nullptr;
+    indirect_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding instance_layout_binding = {};
+    instance_layout_binding.binding = 4;
+    instance_layout_binding.descriptorCount = 1;
+    instance_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instance_layout_binding.pImmutableSamplers = nullptr;
+    instance_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings = {ubo_layout_binding, sampler_layout_binding,
+                                                            object_layout_binding, indirect_layout_binding,
+                                                            instance_layout_binding};
 
     VkDescriptorSetLayoutCreateInfo layout_info = {};
     layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -749,11 +1745,13 @@ void Vulkan::create_descriptor_set_layout()
 
 void Vulkan::create_descriptor_pool()
 {
-    std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
+    std::array<VkDescriptorPoolSize, 3> pool_sizes = {};
     pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     pool_sizes[0].descriptorCount = static_cast<uint32_t>(swap_chain_images.size());
     pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     pool_sizes[1].descriptorCount = static_cast<uint32_t>(swap_chain_images.size());
+    pool_sizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[2].descriptorCount = static_cast<uint32_t>(swap_chain_images.size() * 3);
 
 
     VkDescriptorPoolCreateInfo pool_info = {};
@@ -818,22 +1816,67 @@ void Vulkan::create_descriptor_sets()
                                 static_cast<uint32_t>(descriptor_writes.size()), 
                                 descriptor_writes.data(), 
                                 0, nullptr);
+
+        write_object_descriptors(i);
     }
 }
 
+//Points the image descriptor set at its current object, indirect and instance buffers.
+void Vulkan::write_object_descriptors(uint32_t current_image)
+{
+    VkDescriptorBufferInfo object_buffer_info = {};
+    object_buffer_info.buffer = object_buffers[current_image];
+    object_buffer_info.offset = 0;
+    object_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo indirect_buffer_info = {};
+    indirect_buffer_info.buffer = indirect_buffers[current_image];
+    indirect_buffer_info.offset = 0;
+    indirect_buffer_info.range = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo instance_buffer_info = {};
+    instance_buffer_info.buffer = instance_buffers[current_image];
+    instance_buffer_info.offset = 0;
+    instance_buffer_info.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 3> descriptor_writes{};
+
+    descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[0].dstSet = descriptor_sets[current_image];
+    descriptor_writes[0].dstBinding = 2;
+    descriptor_writes[0].dstArrayElement = 0;
+    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_writes[0].descriptorCount = 1;
+    descriptor_writes[0].pBufferInfo = &object_buffer_info;
+
+    descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[1].dstSet = descriptor_sets[current_image];
+    descriptor_writes[1].dstBinding = 3;
+    descriptor_writes[1].dstArrayElement = 0;
+    descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_writes[1].descriptorCount = 1;
+    descriptor_writes[1].pBufferInfo = &indirect_buffer_info;
+
+    descriptor_writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[2].dstSet = descriptor_sets[current_image];
+    descriptor_writes[2].dstBinding = 4;
+    descriptor_writes[2].dstArrayElement = 0;
+    descriptor_writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_writes[2].descriptorCount = 1;
+    descriptor_writes[2].pBufferInfo = &instance_buffer_info;
+
+    vkUpdateDescriptorSets( logical_device,
+                            static_cast<uint32_t>(descriptor_writes.size()),
+                            descriptor_writes.data(),
+                            0, nullptr);
+}
+
 void Vulkan::draw_text( VulkanFont& font,
                         const char * content,
                         const VkOffset2D& offset,
                         uint32_t layer)
 {
-    VkOffset2D current_offset;
-    current_offset.y = offset.y;
-    for(size_t i = 0; content[i] != '\0'; i++)
-    {
-        current_offset.x = offset.x + i*font.dimensions.width;
-
-        draw_char(font, content[i], current_offset, layer);
-    }
+    sprite_queue.queue_sprites(text_runs.get_run(font, content), layer, offset);
 }
 
 void Vulkan::draw_char( VulkanFont& font,
@@ -841,28 +1884,48 @@ void Vulkan::draw_char( VulkanFont& font,
                         const VkOffset2D& offset,
                         uint32_t layer)
 {
-    char printable = content - 0x20;
-
-    VkRect2D src =  {   (printable%0x20)*(int32_t)font.dimensions.width, 
-                        (printable/0x20)*(int32_t)font.dimensions.height, 
-                        font.dimensions.width, 
-                        font.dimensions.height};
     VkRect2D dst = {    offset.x, offset.y, 
                         font.dimensions.width, font.dimensions.height};
 
-    VulkanSprite* sprite = new VulkanSprite(&font.texture, 
-                                            src, 
-                                            dst);
-    sprite_queue.queue_sprite(sprite, layer);
+    sprite_queue.queue_sprite(VulkanSprite(font.ptr_texture, font.get_glyph_rect(content), dst), layer);
+}
+
+void Vulkan::draw_streamed_sprite(  VulkanStreamedTexture* ptr_streamed,
+                                    const VkRect2D& source,
+                                    const VkRect2D& destination,
+                                    uint32_t layer)
+{
+    VulkanTexture* ptr_texture = texture_streamer->use_texture(ptr_streamed);
+
+    //Source rects belong to the real texture, the placeholder is stretched whole.
+    VkRect2D src = source;
+
+    if(ptr_texture == texture_streamer->placeholder)
+    {
+        src = {0, 0, ptr_texture->image_extent.width, ptr_texture->image_extent.height};
+    }
+
+    sprite_queue.queue_sprite(VulkanSprite(ptr_texture, src, destination), layer);
 }
 
 void Vulkan::update_uniform_buffer(uint32_t current_image)
 {
     UniformBufferObject ubo = {};
-    ubo.model = m4f_rotate(m4f_identity(), Timer::time() * 0.5f, Vector3f(0.8f, 0.0f, 0.5f));
+    ubo.model = a3f_rotate(a3f_identity(), Timer::time() * 0.5f, Vector3f(0.8f, 0.0f, 0.5f));
     ubo.view  = m4f_translate(Vector3f(0.0f, 0.0f, 3.0f));
     ubo.proj  = m4f_perspective(radians(45.0f), (float) WIDTH / (float) HEIGHT, 0.1f, 10.0f);
 
+    //Object spheres are given before ubo.model, so sort, cull and pick levels with it folded in.
+    //The cull shader picks the levels itself.
+    sort_scene_batches(ubo.proj * ubo.view * ubo.model);
+
+    if(!gpu_culling_supported)
+    {
+        cull_scene_objects(ubo.proj * ubo.view * ubo.model);
+        select_scene_lods(ubo.proj * ubo.view * ubo.model, fabsf(ubo.proj.get(1, 1)) * HEIGHT * 0.5f);
+        write_visible_instances(current_image);
+    }
+
     void* data;
     vkMapMemory(logical_device, uniform_buffers_memory[current_image], 0, sizeof(ubo), 0, &data);
         memcpy(data, &ubo, sizeof(ubo));
@@ -0,0 +1,236 @@
+#include "Vulkan.hpp"
+
+static uint64_t get_rect_area(const VkRect2D& rect)
+{
+    return uint64_t(rect.extent.width) * rect.extent.height;
+}
+
+static VkRect2D get_rect_union(const VkRect2D& a, const VkRect2D& b)
+{
+    int32_t x0 = std::min(a.offset.x, b.offset.x);
+    int32_t y0 = std::min(a.offset.y, b.offset.y);
+    int32_t x1 = std::max(a.offset.x + static_cast<int32_t>(a.extent.width), b.offset.x + static_cast<int32_t>(b.extent.width));
+    int32_t y1 = std::max(a.offset.y + static_cast<int32_t>(a.extent.height), b.offset.y + static_cast<int32_t>(b.extent.height));
+
+    return {{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}};
+}
+
+static bool do_rects_overlap(const VkRect2D& a, const VkRect2D& b)
+{
+    return  a.offset.x < b.offset.x + static_cast<int32_t>(b.extent.width) &&
+            b.offset.x < a.offset.x + static_cast<int32_t>(a.extent.width) &&
+            a.offset.y < b.offset.y + static_cast<int32_t>(b.extent.height) &&
+            b.offset.y < a.offset.y + static_cast<int32_t>(a.extent.height);
+}
+
+//A rect overlapping others swallows them, once there are too many the new one goes into
+//the rect it grows the least. Each merge takes a rect out, so it ends.
+void VulkanDamage::add(const VkRect2D& rect)
+{
+    if(full || rect.extent.width == 0 || rect.extent.height == 0)
+    {
+        return;
+    }
+
+    VkRect2D merged = rect;
+
+    while(true)
+    {
+        uint32_t swallow = count;
+
+        for(uint32_t i = 0; i < count && swallow == count; i++)
+        {
+            if(do_rects_overlap(rects[i], merged))
+            {
+                swallow = i;
+            }
+        }
+
+        if(swallow == count && count < DAMAGE_MAX_RECTS)
+        {
+            break;
+        }
+
+        if(swallow == count)
+        {
+            uint64_t best_growth = UINT64_MAX;
+
+            for(uint32_t i = 0; i < count; i++)
+            {
+                uint64_t growth = get_rect_area(get_rect_union(rects[i], merged)) - get_rect_area(rects[i]);
+
+                if(growth < best_growth)
+                {
+                    swallow = i;
+                    best_growth = growth;
+                }
+            }
+        }
+
+        merged = get_rect_union(rects[swallow], merged);
+        rects[swallow] = rects[--count];
+    }
+
+    rects[count++] = merged;
+}
+
+void VulkanDamage::add(const VulkanDamage& damage)
+{
+    if(damage.full)
+    {
+        full = true;
+        count = 0;
+        return;
+    }
+
+    for(uint32_t i = 0; i < damage.count; i++)
+    {
+        add(damage.rects[i]);
+    }
+}
+
+void VulkanDamage::clear()
+{
+    count = 0;
+    full = false;
+}
+
+//Rects don't overlap, so rect is either inside one of them or cut.
+bool VulkanDamage::cuts(const VkRect2D& rect) const
+{
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(do_rects_overlap(rects[i], rect))
+        {
+            return get_rect_union(rects[i], rect).extent.width != rects[i].extent.width ||
+                   get_rect_union(rects[i], rect).extent.height != rects[i].extent.height;
+        }
+    }
+
+    return false;
+}
+
+void VulkanDamageTracker::init(VkExtent2D t_extent, uint32_t image_count)
+{
+    extent = t_extent;
+    image_frames.assign(image_count, 0);
+}
+
+void VulkanDamageTracker::add_frame(const VulkanSpriteQueue& queue, bool full)
+{
+    frame++;
+
+    int32_t width = static_cast<int32_t>(extent.width);
+    int32_t height = static_cast<int32_t>(extent.height);
+
+    //Sprites that don't draw anything can't damage anything either.
+    next_sprites.clear();
+
+    //Sprites of a layer and texture draw in queue order, so each one is hashed together
+    //with the one drawn before it in its group: swapping two changes both of them and the
+    //one after, a sprite put in changes itself and the one after.
+    uint64_t group = UINT64_MAX;
+    uint64_t previous_hash = SPRITE_HASH_SEED;
+
+    for(uint32_t i = 0; i < queue.count; i++)
+    {
+        const VulkanSprite& sprite = queue.get_sorted(i);
+
+        int32_t x0 = std::max(sprite.destination.offset.x, 0);
+        int32_t y0 = std::max(sprite.destination.offset.y, 0);
+        int32_t x1 = std::min(sprite.destination.offset.x + static_cast<int32_t>(sprite.destination.extent.width), width);
+        int32_t y1 = std::min(sprite.destination.offset.y + static_cast<int32_t>(sprite.destination.extent.height), height);
+
+        if(x0 >= x1 || y0 >= y1 || sprite.source.extent.width == 0 || sprite.source.extent.height == 0)
+        {
+            continue;
+        }
+
+        uint64_t sprite_group = queue.ptr_keys[i] & ~SPRITE_KEY_INDEX_MASK;
+        uint64_t sprite_hash = hash_sprite(sprite, queue.ptr_keys[i]);
+
+        if(sprite_group != group)
+        {
+            group = sprite_group;
+            previous_hash = SPRITE_HASH_SEED;
+        }
+
+        VulkanDamageSprite damage_sprite;
+        damage_sprite.hash = hash_sprite(sprite, queue.ptr_keys[i], previous_hash);
+        previous_hash = sprite_hash;
+        damage_sprite.rect = {{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}};
+        damage_sprite.scaled =  sprite.source.extent.width != sprite.destination.extent.width ||
+                                sprite.source.extent.height != sprite.destination.extent.height;
+        next_sprites.push_back(damage_sprite);
+    }
+
+    std::sort(  next_sprites.begin(), next_sprites.end(),
+                [](const VulkanDamageSprite& a, const VulkanDamageSprite& b) { return a.hash < b.hash; });
+
+    VulkanDamage& damage = history[frame % DAMAGE_HISTORY];
+    damage.clear();
+    damage.full = full;
+
+    //Both lists are sorted, so one merge walk finds the sprites only one of them has.
+    size_t p = 0;
+    size_t n = 0;
+
+    while(!full && (p < sprites.size() || n < next_sprites.size()))
+    {
+        if(n == next_sprites.size() || (p < sprites.size() && sprites[p].hash < next_sprites[n].hash))
+        {
+            damage.add(sprites[p++].rect);
+        }
+        else if(p == sprites.size() || next_sprites[n].hash < sprites[p].hash)
+        {
+            damage.add(next_sprites[n++].rect);
+        }
+        else
+        {
+            p++;
+            n++;
+        }
+    }
+
+    std::swap(sprites, next_sprites);
+}
+
+void VulkanDamageTracker::take_image_damage(uint32_t image, VulkanDamage& damage)
+{
+    damage.clear();
+
+    uint64_t last_frame = image_frames[image];
+    image_frames[image] = frame;
+
+    if(last_frame == 0 || frame - last_frame > DAMAGE_HISTORY)
+    {
+        damage.full = true;
+        return;
+    }
+
+    for(uint64_t f = last_frame + 1; f <= frame && !damage.full; f++)
+    {
+        damage.add(history[f % DAMAGE_HISTORY]);
+    }
+
+    bool grown = true;
+
+    while(grown)
+    {
+        grown = false;
+
+        for(const VulkanDamageSprite& sprite : sprites)
+        {
+            if(sprite.scaled && damage.cuts(sprite.rect))
+            {
+                damage.add(sprite.rect);
+                grown = true;
+            }
+        }
+    }
+}
+
+void VulkanDamageTracker::invalidate()
+{
+    std::fill(image_frames.begin(), image_frames.end(), 0);
+}
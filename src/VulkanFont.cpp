@@ -3,7 +3,107 @@
 VulkanFont::VulkanFont(	Vulkan* t_vulkan_instance,
 						VkExtent2D t_dimensions,
 						const char * t_file_location)
-						: texture(t_vulkan_instance, t_file_location)
 {
+	vulkan_instance = t_vulkan_instance;
+	ptr_texture = vulkan_instance->texture_cache->acquire(t_file_location);
 	dimensions = t_dimensions;
-}
\ No newline at end of file
+
+	for(uint32_t glyph = 0; glyph < FONT_GLYPH_COUNT; glyph++)
+	{
+		glyph_rects[glyph] = {	{	static_cast<int32_t>((glyph % 0x20) * dimensions.width),
+									static_cast<int32_t>((glyph / 0x20) * dimensions.height)},
+								dimensions};
+	}
+}
+
+VulkanFont::~VulkanFont()
+{
+	vulkan_instance->texture_cache->release(ptr_texture);
+}
+
+const VkRect2D& VulkanFont::get_glyph_rect(char content) const
+{
+	uint32_t glyph = static_cast<uint8_t>(content) - 0x20u;
+
+	return glyph_rects[glyph < FONT_GLYPH_COUNT ? glyph : 0];
+}
+
+//FNV-1a over the font and text.
+static uint64_t get_text_run_hash(const VulkanFont& font, const char* content)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+
+	auto mix = [&hash](const void* ptr_data, size_t size)
+	{
+		const uint8_t* ptr_bytes = static_cast<const uint8_t*>(ptr_data);
+
+		for(size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ ptr_bytes[i]) * 0x100000001b3;
+		}
+	};
+
+	const VulkanFont* ptr_font = &font;
+	mix(&ptr_font, sizeof(ptr_font));
+	mix(content, strlen(content));
+
+	return hash;
+}
+
+const std::vector<VulkanSprite>& VulkanTextRunCache::get_run(const VulkanFont& font, const char* content)
+{
+	uint64_t hash = get_text_run_hash(font, content);
+
+	auto it = runs.find(hash);
+
+	if(	it != runs.end() &&
+		it->second.ptr_font == &font && it->second.ptr_texture == font.ptr_texture &&
+		it->second.text == content)
+	{
+		hits++;
+		it->second.last_used_frame = frame;
+
+		return it->second.sprites;
+	}
+
+	misses++;
+
+	Run& run = runs[hash];
+	run.ptr_font = &font;
+	run.ptr_texture = font.ptr_texture;
+	run.text = content;
+	run.last_used_frame = frame;
+	run.sprites.clear();
+
+	for(size_t i = 0; content[i] != '\0'; i++)
+	{
+		VkRect2D dst = {	{static_cast<int32_t>(i * font.dimensions.width), 0},
+							font.dimensions};
+
+		run.sprites.push_back(VulkanSprite(font.ptr_texture, font.get_glyph_rect(content[i]), dst));
+	}
+
+	return run.sprites;
+}
+
+void VulkanTextRunCache::update()
+{
+	frame++;
+
+	if(frame % TEXT_RUN_MAX_AGE != 0)
+	{
+		return;
+	}
+
+	for(auto it = runs.begin(); it != runs.end();)
+	{
+		if(it->second.last_used_frame + TEXT_RUN_MAX_AGE < frame)
+		{
+			it = runs.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
@@ -4,7 +4,8 @@
 void Vulkan::create_vulkan_image(   uint32_t width, uint32_t height, 
                                     VkFormat format, 
                                     VkImageUsageFlags usage,
-                                    VkImage& image, VkDeviceMemory& memory)
+                                    VkImage& image, VkDeviceMemory& memory,
+                                    uint32_t mip_levels)
 {
     VkImageCreateInfo create_info = {};
 
@@ -15,7 +16,7 @@ void Vulkan::create_vulkan_image(   uint32_t width, uint32_t height,
     create_info.format = format;
     create_info.extent = {  width, 
                             height, 1};
-    create_info.mipLevels = 1;
+    create_info.mipLevels = mip_levels;
     create_info.arrayLayers = 1;
     create_info.samples = VK_SAMPLE_COUNT_1_BIT;
     create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -45,7 +46,8 @@ void Vulkan::create_vulkan_image(   uint32_t width, uint32_t height,
 }
 
 VkImageView Vulkan::create_image_view(    VkImage image, 
-                                          VkFormat format) 
+                                          VkFormat format,
+                                          uint32_t mip_levels) 
 {
     VkImageViewCreateInfo view_info = {};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -54,7 +56,7 @@ VkImageView Vulkan::create_image_view(    VkImage image,
     view_info.format = format;
     view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     view_info.subresourceRange.baseMipLevel = 0;
-    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.levelCount = mip_levels;
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.layerCount = 1;
 
@@ -264,6 +264,31 @@ void Vulkan::create_logical_device()
     VkPhysicalDeviceFeatures device_features = {};
     device_features.samplerAnisotropy = VK_TRUE;
 
+    //Indirect culling is optional, without it draws are recorded straight from the CPU.
+    VkPhysicalDeviceFeatures available_features;
+    vkGetPhysicalDeviceFeatures(physical_device, &available_features);
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+
+    bool graphics_queue_has_compute = queue_families[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT;
+
+    device_features.drawIndirectFirstInstance = available_features.drawIndirectFirstInstance;
+    device_features.multiDrawIndirect = available_features.multiDrawIndirect;
+
+    //Block compressed textures are uploaded as is when the device takes them, decoded otherwise.
+    device_features.textureCompressionBC = available_features.textureCompressionBC;
+
+    gpu_culling_supported = available_features.drawIndirectFirstInstance && graphics_queue_has_compute;
+    multi_draw_indirect_supported = available_features.multiDrawIndirect;
+    max_draw_indirect_count = multi_draw_indirect_supported ? device_properties.limits.maxDrawIndirectCount : 1;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -0,0 +1,458 @@
+#include "Vulkan.hpp"
+#include "VulkanLayerCache.hpp"
+
+VulkanLayerCache::VulkanLayerCache(Vulkan* vulkan)
+{
+    vulkan_instance = vulkan;
+}
+
+//The device is idle by the time the cache is destroyed.
+VulkanLayerCache::~VulkanLayerCache()
+{
+    for(auto& it : layers)
+    {
+        delete it.second.ptr_texture;
+    }
+
+    for(auto& retired : retired_textures)
+    {
+        delete retired.first;
+    }
+}
+
+void VulkanLayerCache::set_static(uint32_t layer, bool is_static)
+{
+    auto it = layers.find(layer);
+
+    if(is_static && it == layers.end())
+    {
+        layers[layer] = VulkanStaticLayer();
+    }
+    else if(!is_static && it != layers.end())
+    {
+        retire(it->second.ptr_texture);
+        layers.erase(it);
+    }
+}
+
+//Only static layers scroll, others are left alone.
+void VulkanLayerCache::set_scroll(uint32_t layer, VkOffset2D scroll)
+{
+    auto it = layers.find(layer);
+
+    if(it != layers.end())
+    {
+        it->second.scroll = scroll;
+    }
+}
+
+//Only static layers are kept, others are left alone.
+void VulkanLayerCache::set_unchanged(uint32_t layer, bool unchanged)
+{
+    auto it = layers.find(layer);
+
+    if(it != layers.end())
+    {
+        it->second.unchanged = unchanged;
+    }
+}
+
+void VulkanLayerCache::retire(VulkanTexture* ptr_texture)
+{
+    if(ptr_texture != nullptr)
+    {
+        retired_textures.push_back({ptr_texture, frame});
+    }
+}
+
+void VulkanLayerCache::replace_layers(VulkanSpriteQueue& queue)
+{
+    frame++;
+
+    //Every frame that could read a retired image has waited on its fence by now.
+    for(size_t i = 0; i < retired_textures.size();)
+    {
+        if(retired_textures[i].second + vulkan_instance->MAX_FRAMES_IN_FLIGHT <= frame)
+        {
+            delete retired_textures[i].first;
+            retired_textures[i] = retired_textures.back();
+            retired_textures.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if(layers.empty())
+    {
+        return;
+    }
+
+    for(auto& it : layers)
+    {
+        if(!it.second.unchanged)
+        {
+            it.second.sprites.clear();
+            it.second.keys.clear();
+        }
+
+        it.second.redraw = false;
+    }
+
+    //Static sprites come out, the rest move down over them keeping their order.
+    //Sprites of a layer are usually queued together, so the last lookup is kept.
+    uint32_t kept = 0;
+    uint32_t last_layer = UINT32_MAX;
+    auto last_it = layers.end();
+
+    for(uint32_t i = 0; i < queue.count; i++)
+    {
+        uint32_t layer = static_cast<uint32_t>(queue.ptr_keys[i] >> (64 - SPRITE_KEY_LAYER_BITS));
+
+        if(layer != last_layer)
+        {
+            last_layer = layer;
+            last_it = layers.find(layer);
+        }
+
+        if(last_it != layers.end())
+        {
+            if(!last_it->second.unchanged)
+            {
+                last_it->second.sprites.push_back(queue.ptr_sprites[i]);
+            }
+
+            continue;
+        }
+
+        queue.ptr_sprites[kept] = queue.ptr_sprites[i];
+        queue.ptr_keys[kept] = (queue.ptr_keys[i] & ~SPRITE_KEY_INDEX_MASK) | kept;
+        kept++;
+    }
+
+    queue.count = kept;
+
+    for(auto& it : layers)
+    {
+        //An unchanged layer still has the keys, hash and image of the frame it was set in.
+        if(!it.second.unchanged)
+        {
+            update_layer(it.first, it.second, queue);
+        }
+
+        queue_layer(it.first, it.second, queue);
+    }
+}
+
+//Splits the union of rects into disjoint ones. Rows between two rect edges become spans,
+//a row with the same spans as the one above grows its rects, so a grid comes out as few rects.
+static void get_union_regions(const std::vector<VkRect2D>& rects, std::vector<VkRect2D>& regions)
+{
+    regions.clear();
+
+    std::vector<int32_t> edges;
+    std::vector<size_t> order(rects.size());
+
+    for(size_t i = 0; i < rects.size(); i++)
+    {
+        edges.push_back(rects[i].offset.y);
+        edges.push_back(rects[i].offset.y + static_cast<int32_t>(rects[i].extent.height));
+        order[i] = i;
+    }
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::sort(order.begin(), order.end(), [&rects](size_t a, size_t b) { return rects[a].offset.y < rects[b].offset.y; });
+
+    std::vector<size_t> active;
+    std::vector<std::pair<int32_t, int32_t>> spans;
+    std::vector<std::pair<int32_t, int32_t>> open_spans;
+    size_t open_first = 0;
+    size_t next = 0;
+
+    for(size_t edge = 0; edge + 1 < edges.size(); edge++)
+    {
+        int32_t y0 = edges[edge];
+        int32_t y1 = edges[edge + 1];
+
+        while(next < order.size() && rects[order[next]].offset.y <= y0)
+        {
+            active.push_back(order[next++]);
+        }
+
+        spans.clear();
+
+        for(size_t i = 0; i < active.size();)
+        {
+            const VkRect2D& rect = rects[active[i]];
+
+            if(rect.offset.y + static_cast<int32_t>(rect.extent.height) <= y0)
+            {
+                active[i] = active.back();
+                active.pop_back();
+                continue;
+            }
+
+            spans.push_back({rect.offset.x, rect.offset.x + static_cast<int32_t>(rect.extent.width)});
+            i++;
+        }
+
+        std::sort(spans.begin(), spans.end());
+
+        size_t merged = 0;
+
+        for(size_t i = 0; i < spans.size(); i++)
+        {
+            if(merged > 0 && spans[i].first <= spans[merged - 1].second)
+            {
+                spans[merged - 1].second = std::max(spans[merged - 1].second, spans[i].second);
+            }
+            else
+            {
+                spans[merged++] = spans[i];
+            }
+        }
+
+        spans.resize(merged);
+
+        if(spans == open_spans)
+        {
+            for(size_t i = open_first; i < regions.size(); i++)
+            {
+                regions[i].extent.height += static_cast<uint32_t>(y1 - y0);
+            }
+
+            continue;
+        }
+
+        open_spans = spans;
+        open_first = regions.size();
+
+        for(const auto& span : spans)
+        {
+            regions.push_back({{span.first, y0}, {static_cast<uint32_t>(span.second - span.first), static_cast<uint32_t>(y1 - y0)}});
+        }
+    }
+}
+
+void VulkanLayerCache::update_layer(uint32_t layer, VulkanStaticLayer& static_layer, VulkanSpriteQueue& queue)
+{
+    //Same order the queue would draw them in.
+    for(uint32_t i = 0; i < static_layer.sprites.size(); i++)
+    {
+        static_layer.keys.push_back(queue.get_sort_key(static_layer.sprites[i], layer, i));
+    }
+
+    std::sort(static_layer.keys.begin(), static_layer.keys.end());
+
+    uint64_t hash = SPRITE_HASH_SEED;
+    int32_t x0 = INT32_MAX, y0 = INT32_MAX, x1 = INT32_MIN, y1 = INT32_MIN;
+
+    for(uint64_t key : static_layer.keys)
+    {
+        const VulkanSprite& sprite = static_layer.sprites[key & SPRITE_KEY_INDEX_MASK];
+
+        if( sprite.destination.extent.width == 0 || sprite.destination.extent.height == 0 ||
+            sprite.source.extent.width == 0 || sprite.source.extent.height == 0)
+        {
+            continue;
+        }
+
+        hash = hash_sprite(sprite, key, hash);
+
+        x0 = std::min(x0, sprite.destination.offset.x);
+        y0 = std::min(y0, sprite.destination.offset.y);
+        x1 = std::max(x1, sprite.destination.offset.x + static_cast<int32_t>(sprite.destination.extent.width));
+        y1 = std::max(y1, sprite.destination.offset.y + static_cast<int32_t>(sprite.destination.extent.height));
+    }
+
+    static_layer.sprite_hash = hash;
+    static_layer.sprite_bounds = {{0, 0}, {0, 0}};
+
+    if(x0 >= x1)
+    {
+        return;
+    }
+
+    uint32_t width = static_cast<uint32_t>(x1 - x0);
+    uint32_t height = static_cast<uint32_t>(y1 - y0);
+
+    static_layer.sprite_bounds = {{x0, y0}, {width, height}};
+
+    //Too large to hold, queue_layer() puts its sprites back instead.
+    if(width > LAYER_CACHE_MAX_SIZE || height > LAYER_CACHE_MAX_SIZE)
+    {
+        static_layer.drawn = false;
+        return;
+    }
+
+    if(static_layer.drawn && hash == static_layer.hash)
+    {
+        return;
+    }
+
+    //Grown in steps of 64 pixels so a layer changing size a little keeps its image.
+    if( static_layer.ptr_texture == nullptr ||
+        static_layer.ptr_texture->image_extent.width < width ||
+        static_layer.ptr_texture->image_extent.height < height)
+    {
+        retire(static_layer.ptr_texture);
+
+        static_layer.ptr_texture = new VulkanTexture(   vulkan_instance,
+                                                        vulkan_instance->render_target_image_format,
+                                                        std::min((width + 63) & ~63u, LAYER_CACHE_MAX_SIZE),
+                                                        std::min((height + 63) & ~63u, LAYER_CACHE_MAX_SIZE),
+                                                        1,
+                                                        nullptr);
+
+        static_layer.image_defined = false;
+    }
+    else
+    {
+        //New contents, the damage tracker tells images apart by id.
+        static_layer.ptr_texture->id = allocate_texture_id();
+    }
+
+    std::vector<VkRect2D> rects;
+
+    for(uint64_t key : static_layer.keys)
+    {
+        const VkRect2D& destination = static_layer.sprites[key & SPRITE_KEY_INDEX_MASK].destination;
+
+        if(destination.extent.width != 0 && destination.extent.height != 0)
+        {
+            rects.push_back(destination);
+        }
+    }
+
+    get_union_regions(rects, static_layer.regions);
+
+    static_layer.bounds = static_layer.sprite_bounds;
+    static_layer.hash = hash;
+    static_layer.drawn = true;
+    static_layer.redraw = true;
+    redraws++;
+}
+
+void VulkanLayerCache::queue_layer(uint32_t layer, const VulkanStaticLayer& static_layer, VulkanSpriteQueue& queue)
+{
+    if(static_layer.sprite_bounds.extent.width == 0)
+    {
+        return;
+    }
+
+    if(!static_layer.drawn)
+    {
+        for(uint64_t key : static_layer.keys)
+        {
+            VulkanSprite sprite = static_layer.sprites[key & SPRITE_KEY_INDEX_MASK];
+            sprite.destination.offset.x -= static_layer.scroll.x;
+            sprite.destination.offset.y -= static_layer.scroll.y;
+            queue.queue_sprite(sprite, layer);
+        }
+
+        return;
+    }
+
+    int32_t target_width = static_cast<int32_t>(vulkan_instance->render_target_image_extent.width);
+    int32_t target_height = static_cast<int32_t>(vulkan_instance->render_target_image_extent.height);
+
+    //The part of every region on screen goes out as an unscaled sprite.
+    for(const VkRect2D& region : static_layer.regions)
+    {
+        int32_t screen_x0 = std::max(region.offset.x - static_layer.scroll.x, 0);
+        int32_t screen_y0 = std::max(region.offset.y - static_layer.scroll.y, 0);
+        int32_t screen_x1 = std::min(region.offset.x + static_cast<int32_t>(region.extent.width) - static_layer.scroll.x, target_width);
+        int32_t screen_y1 = std::min(region.offset.y + static_cast<int32_t>(region.extent.height) - static_layer.scroll.y, target_height);
+
+        if(screen_x0 >= screen_x1 || screen_y0 >= screen_y1)
+        {
+            continue;
+        }
+
+        VkExtent2D extent = {static_cast<uint32_t>(screen_x1 - screen_x0), static_cast<uint32_t>(screen_y1 - screen_y0)};
+        VkRect2D source = { {   screen_x0 + static_layer.scroll.x - static_layer.bounds.offset.x,
+                                screen_y0 + static_layer.scroll.y - static_layer.bounds.offset.y},
+                            extent};
+        VkRect2D destination = {{screen_x0, screen_y0}, extent};
+
+        queue.queue_sprite(VulkanSprite(static_layer.ptr_texture, source, destination), layer);
+    }
+}
+
+bool VulkanLayerCache::has_redraws() const
+{
+    for(auto& it : layers)
+    {
+        if(it.second.redraw)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VulkanLayerCache::record_redraws(VkCommandBuffer command_buffer)
+{
+    for(auto& it : layers)
+    {
+        VulkanStaticLayer& static_layer = it.second;
+
+        if(!static_layer.redraw)
+        {
+            continue;
+        }
+
+        static_layer.redraw = false;
+
+        VulkanTexture* ptr_texture = static_layer.ptr_texture;
+
+        //A new image has no layout yet, a drawn one waits for earlier frames to be done reading it.
+        vulkan_instance->transition_image_layout_cmd(   command_buffer,
+                                                        ptr_texture->image,
+                                                        ptr_texture->image_format,
+                                                        static_layer.image_defined ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        static_layer.image_defined = true;
+
+        //Same black the render pass clears to.
+        VkClearColorValue black = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        vkCmdClearColorImage(   command_buffer,
+                                ptr_texture->image,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                &black,
+                                1, &range);
+
+        VkMemoryBarrier clear_barrier = {};
+        clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clear_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(   command_buffer,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                0,
+                                1, &clear_barrier,
+                                0, nullptr,
+                                0, nullptr);
+
+        VkRect2D clip = {{0, 0}, static_layer.bounds.extent};
+
+        vulkan_instance->record_sprite_cmds(command_buffer,
+                                            ptr_texture->image, ptr_texture->image_format,
+                                            static_layer.sprites.data(),
+                                            static_layer.keys.data(), static_cast<uint32_t>(static_layer.keys.size()),
+                                            static_layer.bounds.offset,
+                                            &clip, 1);
+
+        vulkan_instance->transition_image_layout_cmd(   command_buffer,
+                                                        ptr_texture->image,
+                                                        ptr_texture->image_format,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    }
+}
@@ -0,0 +1,370 @@
+#include "Vulkan.hpp"
+
+VulkanMeshPool::VulkanMeshPool( Vulkan* vulkan,
+                                VertexFormat t_vertex_format,
+                                uint32_t t_max_vertices,
+                                VkDeviceSize t_max_index_bytes,
+                                VkDeviceSize t_upload_budget)
+{
+    vulkan_instance = vulkan;
+    vertex_format = t_vertex_format;
+    vertex_stride = get_vertex_stride(vertex_format);
+    max_vertices = t_max_vertices;
+    max_index_bytes = t_max_index_bytes;
+    upload_budget = t_upload_budget;
+
+    vulkan_instance->create_buffer( static_cast<VkDeviceSize>(max_vertices) * vertex_stride,
+                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                    vertex_buffer,
+                                    vertex_buffer_memory);
+
+    vulkan_instance->create_buffer( max_index_bytes,
+                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                    index_buffer,
+                                    index_buffer_memory);
+
+    //Stays mapped, it is only written while no upload is in flight.
+    vulkan_instance->create_buffer( upload_budget,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                    staging_buffer,
+                                    staging_buffer_memory);
+
+    void* data;
+    vkMapMemory(vulkan_instance->logical_device, staging_buffer_memory, 0, upload_budget, 0, &data);
+    ptr_staging = static_cast<uint8_t*>(data);
+
+    VkCommandBufferAllocateInfo allocate_info = {};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandPool = vulkan_instance->command_pool;
+    allocate_info.commandBufferCount = 1;
+
+    if(vkAllocateCommandBuffers(vulkan_instance->logical_device, &allocate_info, &upload_command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate mesh upload command buffer.");
+    }
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if(vkCreateFence(vulkan_instance->logical_device, &fence_info, nullptr, &upload_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create mesh upload fence.");
+    }
+
+    loader_thread = std::thread(&VulkanMeshPool::loader_loop, this);
+}
+
+VulkanMeshPool::~VulkanMeshPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        stop_loader = true;
+    }
+
+    loader_condition.notify_all();
+    loader_thread.join();
+
+    if(upload_pending)
+    {
+        vkWaitForFences(vulkan_instance->logical_device, 1, &upload_fence, VK_TRUE, UINT64_MAX);
+    }
+
+    VkDevice device = vulkan_instance->logical_device;
+
+    vkDestroyFence(device, upload_fence, nullptr);
+    vkFreeCommandBuffers(device, vulkan_instance->command_pool, 1, &upload_command_buffer);
+
+    vkUnmapMemory(device, staging_buffer_memory);
+    vkDestroyBuffer(device, staging_buffer, nullptr);
+    vkFreeMemory(device, staging_buffer_memory, nullptr);
+
+    vkDestroyBuffer(device, vertex_buffer, nullptr);
+    vkFreeMemory(device, vertex_buffer_memory, nullptr);
+
+    vkDestroyBuffer(device, index_buffer, nullptr);
+    vkFreeMemory(device, index_buffer_memory, nullptr);
+
+    for(VulkanMesh* ptr_mesh : meshes)
+    {
+        delete ptr_mesh;
+    }
+}
+
+VulkanMesh* VulkanMeshPool::load_mesh(const char* file)
+{
+    VulkanMesh* ptr_mesh = new VulkanMesh();
+    ptr_mesh->file = file;
+    meshes.push_back(ptr_mesh);
+
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        load_queue.push_back(ptr_mesh);
+    }
+
+    loader_condition.notify_one();
+
+    return ptr_mesh;
+}
+
+bool VulkanMeshPool::is_idle()
+{
+    for(VulkanMesh* ptr_mesh : meshes)
+    {
+        if(ptr_mesh->state == MESH_LOADING || ptr_mesh->state == MESH_UPLOADING)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Parses and builds meshes one at a time, the GPU side is left to update().
+void VulkanMeshPool::loader_loop()
+{
+    while(true)
+    {
+        VulkanMesh* ptr_mesh;
+
+        {
+            std::unique_lock<std::mutex> lock(loader_mutex);
+            loader_condition.wait(lock, [this] { return stop_loader || !load_queue.empty(); });
+
+            if(stop_loader)
+            {
+                return;
+            }
+
+            ptr_mesh = load_queue.front();
+            load_queue.pop_front();
+        }
+
+        LoadedMesh loaded;
+        loaded.ptr_mesh = ptr_mesh;
+
+        try
+        {
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+
+            load_mesh_file(ptr_mesh->file.c_str(), vertices, indices);
+
+            if(indices.empty())
+            {
+                throw std::runtime_error("Mesh has no triangles: " + ptr_mesh->file);
+            }
+
+            loaded.data = build_mesh(std::move(vertices), std::move(indices), vertex_format, true, MAX_MESH_LODS);
+        }
+        catch(const std::exception& e)
+        {
+            loaded.error_msg = e.what();
+        }
+
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        ready_queue.push_back(std::move(loaded));
+    }
+}
+
+//Hands out the arena ranges of a freshly built mesh.
+void VulkanMeshPool::allocate(LoadedMesh& loaded)
+{
+    VulkanMesh* ptr_mesh = loaded.ptr_mesh;
+    MeshData& data = loaded.data;
+
+    if(!loaded.error_msg.empty())
+    {
+        std::cerr << "Failed to load mesh: " << loaded.error_msg << std::endl;
+        ptr_mesh->state = MESH_FAILED;
+        return;
+    }
+
+    VkDeviceSize index_size = data.index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+    VkDeviceSize index_offset = (used_index_bytes + index_size - 1) / index_size * index_size;
+
+    if( data.vertex_count > max_vertices - used_vertices ||
+        index_offset + data.index_data.size() > max_index_bytes)
+    {
+        std::cerr << "Mesh pool is full, could not fit: " << ptr_mesh->file << std::endl;
+        ptr_mesh->state = MESH_FAILED;
+        return;
+    }
+
+    ptr_mesh->index_type = data.index_type;
+    ptr_mesh->first_index = static_cast<uint32_t>(index_offset / index_size);
+    ptr_mesh->vertex_offset = static_cast<int32_t>(used_vertices);
+    ptr_mesh->vertex_count = data.vertex_count;
+    ptr_mesh->dequantize = data.dequantize;
+    ptr_mesh->bounds_min = data.bounds_min;
+    ptr_mesh->bounds_max = data.bounds_max;
+    ptr_mesh->lod_count = data.lod_count;
+    ptr_mesh->state = MESH_UPLOADING;
+
+    for(uint32_t l = 0; l < data.lod_count; l++)
+    {
+        ptr_mesh->lods[l] = data.lods[l];
+        ptr_mesh->lods[l].first_index += ptr_mesh->first_index;
+    }
+
+    ptr_mesh->index_count = data.lods[0].index_count;
+
+    used_vertices += data.vertex_count;
+    used_index_bytes = index_offset + data.index_data.size();
+
+    PendingUpload upload;
+    upload.ptr_mesh = ptr_mesh;
+    upload.data = std::move(data);
+    upload_queue.push_back(std::move(upload));
+}
+
+//Copies as much of the queued meshes as fits in the staging buffer and submits it.
+void VulkanMeshPool::submit_uploads()
+{
+    std::vector<VkBufferCopy> vertex_copies;
+    std::vector<VkBufferCopy> index_copies;
+    VkDeviceSize staged = 0;
+
+    while(!upload_queue.empty() && staged < upload_budget)
+    {
+        PendingUpload& upload = upload_queue.front();
+        VulkanMesh* ptr_mesh = upload.ptr_mesh;
+
+        VkDeviceSize vertex_bytes = std::min(   upload.data.vertex_data.size() - upload.vertex_bytes_done,
+                                                upload_budget - staged);
+        if(vertex_bytes > 0)
+        {
+            memcpy(ptr_staging + staged, upload.data.vertex_data.data() + upload.vertex_bytes_done, vertex_bytes);
+
+            VkBufferCopy copy = {};
+            copy.srcOffset = staged;
+            copy.dstOffset = static_cast<VkDeviceSize>(ptr_mesh->vertex_offset) * vertex_stride + upload.vertex_bytes_done;
+            copy.size = vertex_bytes;
+            vertex_copies.push_back(copy);
+
+            staged += vertex_bytes;
+            upload.vertex_bytes_done += vertex_bytes;
+        }
+
+        VkDeviceSize index_size = ptr_mesh->index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+        VkDeviceSize index_bytes = std::min(    upload.data.index_data.size() - upload.index_bytes_done,
+                                                upload_budget - staged);
+        if(index_bytes > 0)
+        {
+            memcpy(ptr_staging + staged, upload.data.index_data.data() + upload.index_bytes_done, index_bytes);
+
+            VkBufferCopy copy = {};
+            copy.srcOffset = staged;
+            copy.dstOffset = ptr_mesh->first_index * index_size + upload.index_bytes_done;
+            copy.size = index_bytes;
+            index_copies.push_back(copy);
+
+            staged += index_bytes;
+            upload.index_bytes_done += index_bytes;
+        }
+
+        if( upload.vertex_bytes_done == upload.data.vertex_data.size() &&
+            upload.index_bytes_done == upload.data.index_data.size())
+        {
+            uploads_in_flight.push_back(ptr_mesh);
+            upload_queue.pop_front();
+        }
+    }
+
+    if(staged == 0)
+    {
+        return;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(upload_command_buffer, &begin_info);
+
+    if(!vertex_copies.empty())
+    {
+        vkCmdCopyBuffer(upload_command_buffer, staging_buffer, vertex_buffer, vertex_copies.size(), vertex_copies.data());
+    }
+
+    if(!index_copies.empty())
+    {
+        vkCmdCopyBuffer(upload_command_buffer, staging_buffer, index_buffer, index_copies.size(), index_copies.data());
+    }
+
+    //Later submissions only draw these ranges once the fence says so,
+    //the barrier still makes the writes visible to their vertex input.
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier(   upload_command_buffer,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                            0,
+                            1, &barrier,
+                            0, nullptr,
+                            0, nullptr);
+
+    if(vkEndCommandBuffer(upload_command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record mesh upload command buffer.");
+    }
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &upload_command_buffer;
+
+    vkResetFences(vulkan_instance->logical_device, 1, &upload_fence);
+
+    if(vkQueueSubmit(vulkan_instance->graphics_queue, 1, &submit_info, upload_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit mesh upload.");
+    }
+
+    upload_pending = true;
+}
+
+void VulkanMeshPool::update()
+{
+    //The staging buffer is busy until the previous upload lands.
+    if(upload_pending)
+    {
+        if(vkGetFenceStatus(vulkan_instance->logical_device, upload_fence) != VK_SUCCESS)
+        {
+            return;
+        }
+
+        upload_pending = false;
+
+        for(VulkanMesh* ptr_mesh : uploads_in_flight)
+        {
+            ptr_mesh->state = MESH_RESIDENT;
+        }
+
+        if(!uploads_in_flight.empty())
+        {
+            generation++;
+        }
+
+        uploads_in_flight.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        loaded_meshes.swap(ready_queue);
+    }
+
+    for(LoadedMesh& loaded : loaded_meshes)
+    {
+        allocate(loaded);
+    }
+
+    loaded_meshes.clear();
+
+    submit_uploads();
+}
@@ -0,0 +1,811 @@
+#include "Vulkan.hpp"
+#include "VulkanMeshBuilder.hpp"
+
+//Size of the simulated LRU cache used while scoring vertices.
+//Bigger than most real caches, the extra entries only add a bit of lookahead.
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float forsyth_vertex_score(int cache_position, uint32_t live_triangles)
+{
+    if(live_triangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if(cache_position >= 0)
+    {
+        if(cache_position < 3)
+        {
+            //The last triangle used it, deliberately not the best choice so strips don't get too long.
+            score = 0.75f;
+        }
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+
+    //Bonus for vertices with few triangles left, so lone triangles are not left behind.
+    score += 2.0f * powf(static_cast<float>(live_triangles), -0.5f);
+
+    return score;
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+    size_t triangle_count = indices.size() / 3;
+
+    if(triangle_count == 0)
+    {
+        return;
+    }
+
+    //Triangle adjacency for each vertex, as a flattened list.
+    std::vector<uint32_t> live_triangles(vertex_count, 0);
+    for(uint32_t index : indices) live_triangles[index]++;
+
+    std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+    for(uint32_t v = 0; v < vertex_count; v++)
+    {
+        adjacency_offset[v + 1] = adjacency_offset[v] + live_triangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacency_fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+
+    for(size_t t = 0; t < triangle_count; t++)
+    {
+        for(int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t * 3 + k];
+            adjacency[adjacency_fill[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+
+    for(uint32_t v = 0; v < vertex_count; v++)
+    {
+        vertex_score[v] = forsyth_vertex_score(-1, live_triangles[v]);
+    }
+
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<bool> triangle_emitted(triangle_count, false);
+
+    for(size_t t = 0; t < triangle_count; t++)
+    {
+        triangle_score[t] = vertex_score[indices[t * 3 + 0]] +
+                            vertex_score[indices[t * 3 + 1]] +
+                            vertex_score[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    //Cache has 3 extra slots for the vertices pushed by the current triangle.
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+
+    size_t input_cursor = 0;
+
+    int64_t best_triangle = -1;
+    float best_score = -1.0f;
+
+    for(size_t t = 0; t < triangle_count; t++)
+    {
+        if(triangle_score[t] > best_score)
+        {
+            best_score = triangle_score[t];
+            best_triangle = t;
+        }
+    }
+
+    while(best_triangle >= 0)
+    {
+        const uint32_t* triangle = &indices[best_triangle * 3];
+
+        triangle_emitted[best_triangle] = true;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        //Push the triangle vertices to the front of the cache.
+        uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t new_count = 0;
+
+        for(int k = 0; k < 3; k++)
+        {
+            new_cache[new_count++] = triangle[k];
+
+            //Remove the triangle from the adjacency of its vertices.
+            uint32_t v = triangle[k];
+            uint32_t* begin = &adjacency[adjacency_offset[v]];
+            uint32_t* end = begin + live_triangles[v];
+            uint32_t* found = std::find(begin, end, static_cast<uint32_t>(best_triangle));
+
+            *found = *(end - 1);
+            live_triangles[v]--;
+        }
+
+        for(uint32_t i = 0; i < cache_count; i++)
+        {
+            uint32_t v = cache[i];
+
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        //Vertices falling out of the cache lose their cache score.
+        for(uint32_t i = FORSYTH_CACHE_SIZE; i < new_count; i++)
+        {
+            cache_position[new_cache[i]] = -1;
+            vertex_score[new_cache[i]] = forsyth_vertex_score(-1, live_triangles[new_cache[i]]);
+        }
+
+        cache_count = std::min(new_count, static_cast<uint32_t>(FORSYTH_CACHE_SIZE));
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+        //Rescore everything still in the cache, and the triangles they touch.
+        best_triangle = -1;
+        best_score = -1.0f;
+
+        for(uint32_t i = 0; i < cache_count; i++)
+        {
+            uint32_t v = cache[i];
+            cache_position[v] = i;
+            vertex_score[v] = forsyth_vertex_score(i, live_triangles[v]);
+        }
+
+        for(uint32_t i = 0; i < cache_count; i++)
+        {
+            uint32_t v = cache[i];
+
+            for(uint32_t a = 0; a < live_triangles[v]; a++)
+            {
+                uint32_t t = adjacency[adjacency_offset[v] + a];
+
+                triangle_score[t] = vertex_score[indices[t * 3 + 0]] +
+                                    vertex_score[indices[t * 3 + 1]] +
+                                    vertex_score[indices[t * 3 + 2]];
+
+                if(triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best_triangle = t;
+                }
+            }
+        }
+
+        //Nothing in the cache has triangles left, continue from the next unused one.
+        if(best_triangle < 0)
+        {
+            while(input_cursor < triangle_count && triangle_emitted[input_cursor])
+            {
+                input_cursor++;
+            }
+
+            if(input_cursor < triangle_count)
+            {
+                best_triangle = input_cursor;
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+float get_average_cache_miss_ratio( const std::vector<uint32_t>& indices,
+                                    uint32_t vertex_count,
+                                    uint32_t cache_size)
+{
+    if(indices.size() < 3)
+    {
+        return 0.0f;
+    }
+
+    //Timestamp based FIFO, a vertex is in the cache if it was pushed less than cache_size pushes ago.
+    std::vector<uint32_t> pushed_at(vertex_count, 0);
+    uint32_t timestamp = cache_size + 1;
+    uint32_t misses = 0;
+
+    for(uint32_t index : indices)
+    {
+        if(timestamp - pushed_at[index] > cache_size)
+        {
+            pushed_at[index] = timestamp++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+void optimize_overdraw( std::vector<uint32_t>& indices,
+                        const std::vector<Vertex>& vertices,
+                        float threshold)
+{
+    const uint32_t cache_size = 16;
+    size_t triangle_count = indices.size() / 3;
+
+    if(triangle_count < 2)
+    {
+        return;
+    }
+
+    //Split into clusters. A hard boundary is where the cache got flushed (all 3 vertices miss),
+    //a soft boundary is anywhere the cluster ACMR is still under threshold * the mesh ACMR.
+    std::vector<uint32_t> pushed_at(vertices.size(), 0);
+    uint32_t timestamp = cache_size + 1;
+
+    std::vector<size_t> cluster_start;
+    cluster_start.push_back(0);
+
+    float target_acmr = get_average_cache_miss_ratio(indices, vertices.size(), cache_size) * threshold;
+    uint32_t cluster_misses = 0;
+
+    for(size_t t = 0; t < triangle_count; t++)
+    {
+        uint32_t misses = 0;
+
+        for(int k = 0; k < 3; k++)
+        {
+            uint32_t index = indices[t * 3 + k];
+
+            if(timestamp - pushed_at[index] > cache_size)
+            {
+                pushed_at[index] = timestamp++;
+                misses++;
+            }
+        }
+
+        size_t cluster_size = t - cluster_start.back();
+
+        if(t > 0 && cluster_size > 0)
+        {
+            bool hard_boundary = misses == 3;
+            bool soft_boundary = static_cast<float>(cluster_misses) / cluster_size <= target_acmr;
+
+            if(hard_boundary && soft_boundary)
+            {
+                cluster_start.push_back(t);
+                cluster_misses = 0;
+            }
+        }
+
+        cluster_misses += misses;
+    }
+
+    size_t cluster_count = cluster_start.size();
+    cluster_start.push_back(triangle_count);
+
+    if(cluster_count < 2)
+    {
+        return;
+    }
+
+    //Sort clusters by how far out they sit along their own facing direction.
+    Vector3f mesh_centroid = v3f_zero();
+
+    for(const Vertex& vertex : vertices)
+    {
+        mesh_centroid += vertex.pos;
+    }
+
+    mesh_centroid /= static_cast<float>(vertices.size());
+
+    std::vector<std::pair<float, size_t>> cluster_sort(cluster_count);
+
+    for(size_t c = 0; c < cluster_count; c++)
+    {
+        Vector3f centroid = v3f_zero();
+        Vector3f normal = v3f_zero();
+        float area = 0.0f;
+
+        for(size_t t = cluster_start[c]; t < cluster_start[c + 1]; t++)
+        {
+            const Vector3f& p0 = vertices[indices[t * 3 + 0]].pos;
+            const Vector3f& p1 = vertices[indices[t * 3 + 1]].pos;
+            const Vector3f& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            Vector3f triangle_normal = v3f_cross(p1 - p0, p2 - p0);
+            float triangle_area = triangle_normal.length();
+
+            centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+            normal += triangle_normal;
+            area += triangle_area;
+        }
+
+        float dot = 0.0f;
+
+        if(area > 0.0f && normal.squared_length() > 0.0f)
+        {
+            centroid /= area;
+            dot = v3f_dot(centroid - mesh_centroid, normal.unit());
+        }
+
+        cluster_sort[c] = std::make_pair(-dot, c);
+    }
+
+    std::stable_sort(   cluster_sort.begin(), cluster_sort.end(),
+                        [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b)
+                        {
+                            return a.first < b.first;
+                        });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    for(const auto& sorted : cluster_sort)
+    {
+        size_t c = sorted.second;
+
+        result.insert(  result.end(),
+                        indices.begin() + cluster_start[c] * 3,
+                        indices.begin() + cluster_start[c + 1] * 3);
+    }
+
+    indices.swap(result);
+}
+
+void optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for(uint32_t& index : indices)
+    {
+        if(remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+static int16_t quantize_snorm16(float value)
+{
+    value = std::max(-1.0f, std::min(1.0f, value));
+
+    return static_cast<int16_t>(lroundf(value * 32767.0f));
+}
+
+//Symmetric 4x4 matrix summing squared distances to planes, stored as its upper triangle.
+struct Quadric
+{
+    double a[10] = {};
+
+    void add_plane(double x, double y, double z, double w)
+    {
+        a[0] += x * x; a[1] += x * y; a[2] += x * z; a[3] += x * w;
+        a[4] += y * y; a[5] += y * z; a[6] += y * w;
+        a[7] += z * z; a[8] += z * w;
+        a[9] += w * w;
+    }
+
+    void add(const Quadric& q)
+    {
+        for(int i = 0; i < 10; i++)
+        {
+            a[i] += q.a[i];
+        }
+    }
+
+    double evaluate(const Vector3f& p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+
+        return  a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x +
+                a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y +
+                a[7] * z * z + 2.0 * a[8] * z +
+                a[9];
+    }
+};
+
+static uint64_t get_edge_key(uint32_t a, uint32_t b)
+{
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+//True if moving vertex from onto to turns any triangle around from over, or flattens it.
+static bool collapse_flips(  const std::vector<Vertex>& vertices,
+                             const std::vector<uint32_t>& indices,
+                             const std::vector<uint32_t>& triangles,
+                             uint32_t from, uint32_t to)
+{
+    for(uint32_t t : triangles)
+    {
+        const uint32_t* ptr_triangle = &indices[t * 3];
+
+        if(ptr_triangle[0] == to || ptr_triangle[1] == to || ptr_triangle[2] == to)
+        {
+            continue;
+        }
+
+        Vector3f before[3];
+        Vector3f after[3];
+
+        for(int c = 0; c < 3; c++)
+        {
+            before[c] = vertices[ptr_triangle[c]].pos;
+            after[c] = ptr_triangle[c] == from ? vertices[to].pos : before[c];
+        }
+
+        Vector3f normal_before = v3f_cross(before[1] - before[0], before[2] - before[0]);
+        Vector3f normal_after = v3f_cross(after[1] - after[0], after[2] - after[0]);
+
+        if(v3f_dot(normal_before, normal_after) <= 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float simplify_mesh(const std::vector<Vertex>& vertices,
+                    std::vector<uint32_t>& indices,
+                    uint32_t target_index_count)
+{
+    uint32_t vertex_count = vertices.size();
+
+    std::vector<Quadric> quadrics(vertex_count);
+
+    for(size_t t = 0; t < indices.size(); t += 3)
+    {
+        const Vector3f& p0 = vertices[indices[t]].pos;
+        const Vector3f& p1 = vertices[indices[t + 1]].pos;
+        const Vector3f& p2 = vertices[indices[t + 2]].pos;
+
+        Vector3f normal = v3f_cross(p1 - p0, p2 - p0);
+        float length = normal.length();
+
+        if(length == 0.0f)
+        {
+            continue;
+        }
+
+        normal /= length;
+        float distance = -v3f_dot(normal, p0);
+
+        for(int c = 0; c < 3; c++)
+        {
+            quadrics[indices[t + c]].add_plane(normal[0], normal[1], normal[2], distance);
+        }
+    }
+
+    //Edges not shared by exactly two triangles are borders or non manifold, their vertices stay.
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+
+    for(size_t t = 0; t < indices.size(); t += 3)
+    {
+        for(int c = 0; c < 3; c++)
+        {
+            edges.push_back(get_edge_key(indices[t + c], indices[t + (c + 1) % 3]));
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<uint8_t> locked(vertex_count, 0);
+
+    for(size_t e = 0; e < edges.size();)
+    {
+        size_t run = 1;
+
+        while(e + run < edges.size() && edges[e + run] == edges[e])
+        {
+            run++;
+        }
+
+        if(run != 2)
+        {
+            locked[edges[e] >> 32] = 1;
+            locked[edges[e] & 0xFFFFFFFF] = 1;
+        }
+
+        e += run;
+    }
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<uint8_t> touched(vertex_count);
+    std::vector<uint32_t> triangle_offsets(vertex_count + 1);
+    std::vector<uint32_t> vertex_triangles;
+    std::vector<uint32_t> from_triangles;
+    double max_cost = 0.0;
+
+    //Each pass collapses the cheapest edges whose neighbourhoods do not overlap,
+    //then rebuilds the index list.
+    while(indices.size() > target_index_count)
+    {
+        edges.clear();
+
+        for(size_t t = 0; t < indices.size(); t += 3)
+        {
+            for(int c = 0; c < 3; c++)
+            {
+                edges.push_back(get_edge_key(indices[t + c], indices[t + (c + 1) % 3]));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::vector<Collapse> collapses;
+        collapses.reserve(edges.size());
+
+        for(uint64_t edge : edges)
+        {
+            uint32_t a = edge >> 32;
+            uint32_t b = edge & 0xFFFFFFFF;
+
+            if(locked[a] && locked[b])
+            {
+                continue;
+            }
+
+            Quadric quadric = quadrics[a];
+            quadric.add(quadrics[b]);
+
+            double cost_a_to_b = locked[a] ? DBL_MAX : quadric.evaluate(vertices[b].pos);
+            double cost_b_to_a = locked[b] ? DBL_MAX : quadric.evaluate(vertices[a].pos);
+
+            if(cost_a_to_b <= cost_b_to_a)
+            {
+                collapses.push_back({a, b, cost_a_to_b});
+            }
+            else
+            {
+                collapses.push_back({b, a, cost_b_to_a});
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        //Vertex to triangle adjacency of the current index list.
+        std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+
+        for(uint32_t index : indices)
+        {
+            triangle_offsets[index + 1]++;
+        }
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets[v + 1] += triangle_offsets[v];
+        }
+
+        vertex_triangles.resize(indices.size());
+        std::vector<uint32_t> fill(triangle_offsets.begin(), triangle_offsets.end() - 1);
+
+        for(size_t i = 0; i < indices.size(); i++)
+        {
+            vertex_triangles[fill[indices[i]]++] = i / 3;
+        }
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            remap[v] = v;
+        }
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t triangles_left = indices.size() / 3;
+        size_t target_triangles = target_index_count / 3;
+        size_t collapse_count = 0;
+
+        for(const Collapse& collapse : collapses)
+        {
+            if(triangles_left <= target_triangles)
+            {
+                break;
+            }
+
+            if(touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            from_triangles.assign(  vertex_triangles.begin() + triangle_offsets[collapse.from],
+                                    vertex_triangles.begin() + triangle_offsets[collapse.from + 1]);
+
+            if(collapse_flips(vertices, indices, from_triangles, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            for(uint32_t t : from_triangles)
+            {
+                for(int c = 0; c < 3; c++)
+                {
+                    touched[indices[t * 3 + c]] = 1;
+
+                    if(indices[t * 3 + c] == collapse.to)
+                    {
+                        triangles_left--;
+                    }
+                }
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            max_cost = std::max(max_cost, collapse.cost);
+            collapse_count++;
+        }
+
+        if(collapse_count == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+
+        for(size_t t = 0; t < indices.size(); t += 3)
+        {
+            uint32_t i0 = remap[indices[t]];
+            uint32_t i1 = remap[indices[t + 1]];
+            uint32_t i2 = remap[indices[t + 2]];
+
+            if(i0 == i1 || i1 == i2 || i2 == i0)
+            {
+                continue;
+            }
+
+            indices[write++] = i0;
+            indices[write++] = i1;
+            indices[write++] = i2;
+        }
+
+        indices.resize(write);
+    }
+
+    //The quadric sums squared plane distances, close enough to a distance once rooted.
+    return static_cast<float>(sqrt(std::max(max_cost, 0.0)));
+}
+
+static uint8_t quantize_unorm8(float value)
+{
+    value = std::max(0.0f, std::min(1.0f, value));
+
+    return static_cast<uint8_t>(lroundf(value * 255.0f));
+}
+
+MeshData build_mesh(std::vector<Vertex> vertices,
+                    std::vector<uint32_t> indices,
+                    VertexFormat vertex_format,
+                    bool optimize,
+                    uint32_t lod_count)
+{
+    MeshData mesh;
+
+    if(optimize)
+    {
+        optimize_vertex_cache(indices, vertices.size());
+        optimize_overdraw(indices, vertices);
+        optimize_vertex_fetch(vertices, indices);
+    }
+
+    mesh.lods[0].index_count = indices.size();
+
+    //Every level simplifies the one before it, errors add up along the chain.
+    std::vector<uint32_t> lod_indices = indices;
+
+    while(mesh.lod_count < std::min(lod_count, MAX_MESH_LODS))
+    {
+        const MeshLod& previous = mesh.lods[mesh.lod_count - 1];
+
+        float error = simplify_mesh(vertices, lod_indices, previous.index_count / 6 * 3);
+
+        if(lod_indices.size() > previous.index_count * 3 / 4)
+        {
+            break;
+        }
+
+        if(optimize)
+        {
+            optimize_vertex_cache(lod_indices, vertices.size());
+        }
+
+        MeshLod& lod = mesh.lods[mesh.lod_count++];
+        lod.first_index = indices.size();
+        lod.index_count = lod_indices.size();
+        lod.error = previous.error + error;
+
+        indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+    }
+
+    mesh.vertex_format = vertex_format;
+    mesh.vertex_count = vertices.size();
+    mesh.index_count = indices.size();
+
+    if(!vertices.empty())
+    {
+        mesh.bounds_min = vertices[0].pos;
+        mesh.bounds_max = vertices[0].pos;
+    }
+
+    for(const Vertex& vertex : vertices)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            mesh.bounds_min[i] = std::min(mesh.bounds_min[i], vertex.pos[i]);
+            mesh.bounds_max[i] = std::max(mesh.bounds_max[i], vertex.pos[i]);
+        }
+    }
+
+    if(vertex_format == VERTEX_FORMAT_COMPACT)
+    {
+        //Positions are stored relative to the bounds, in [-1, 1].
+        Vector3f center = (mesh.bounds_min + mesh.bounds_max) * 0.5f;
+        Vector3f extent = (mesh.bounds_max - mesh.bounds_min) * 0.5f;
+
+        for(int i = 0; i < 3; i++)
+        {
+            if(extent[i] <= 0.0f) extent[i] = 1.0f;
+        }
+
+        mesh.dequantize = a3f_translate(center) * a3f_scale(extent);
+
+        mesh.vertex_data.resize(vertices.size() * sizeof(VertexCompact));
+        VertexCompact* ptr_compact = reinterpret_cast<VertexCompact*>(mesh.vertex_data.data());
+
+        for(size_t v = 0; v < vertices.size(); v++)
+        {
+            Vector3f local = (vertices[v].pos - center) / extent;
+
+            ptr_compact[v].pos[0] = quantize_snorm16(local[0]);
+            ptr_compact[v].pos[1] = quantize_snorm16(local[1]);
+            ptr_compact[v].pos[2] = quantize_snorm16(local[2]);
+            ptr_compact[v].pos[3] = 32767;
+
+            ptr_compact[v].color[0] = quantize_unorm8(vertices[v].color[0]);
+            ptr_compact[v].color[1] = quantize_unorm8(vertices[v].color[1]);
+            ptr_compact[v].color[2] = quantize_unorm8(vertices[v].color[2]);
+            ptr_compact[v].color[3] = 255;
+
+            ptr_compact[v].tex_coord[0] = float_to_half(vertices[v].tex_coord[0]);
+            ptr_compact[v].tex_coord[1] = float_to_half(vertices[v].tex_coord[1]);
+        }
+    }
+    else
+    {
+        mesh.vertex_data.resize(vertices.size() * sizeof(Vertex));
+        memcpy(mesh.vertex_data.data(), vertices.data(), mesh.vertex_data.size());
+    }
+
+    if(vertices.size() <= UINT16_MAX)
+    {
+        mesh.index_type = VK_INDEX_TYPE_UINT16;
+        mesh.index_data.resize(indices.size() * sizeof(uint16_t));
+        uint16_t* ptr_index = reinterpret_cast<uint16_t*>(mesh.index_data.data());
+
+        for(size_t i = 0; i < indices.size(); i++)
+        {
+            ptr_index[i] = static_cast<uint16_t>(indices[i]);
+        }
+    }
+    else
+    {
+        mesh.index_type = VK_INDEX_TYPE_UINT32;
+        mesh.index_data.resize(indices.size() * sizeof(uint32_t));
+        memcpy(mesh.index_data.data(), indices.data(), mesh.index_data.size());
+    }
+
+    return mesh;
+}
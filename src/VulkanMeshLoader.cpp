@@ -0,0 +1,521 @@
+#include "Vulkan.hpp"
+#include "VulkanMeshLoader.hpp"
+#include "Json.hpp"
+
+#include <unordered_map>
+
+//OBJ
+//Parses an OBJ index, which is 1 based or negative (relative to the end).
+static bool parse_obj_index(const char*& cursor, int32_t count, int32_t& index)
+{
+    char* end;
+    long value = strtol(cursor, &end, 10);
+
+    if(end == cursor)
+    {
+        return false;
+    }
+
+    cursor = end;
+    index = value < 0 ? count + value : value - 1;
+
+    return true;
+}
+
+void load_obj_mesh( const char* file,
+                    std::vector<Vertex>& vertices,
+                    std::vector<uint32_t>& indices)
+{
+    std::vector<char> buffer = read_file(file);
+    buffer.push_back('\0');
+
+    std::vector<Vector3f> positions;
+    std::vector<Vector3f> colors;
+    std::vector<Vector2f> tex_coords;
+
+    //Each distinct position/tex_coord pair becomes one vertex.
+    std::unordered_map<uint64_t, uint32_t> vertex_lookup;
+    std::vector<uint32_t> face;
+
+    const char* cursor = buffer.data();
+
+    while(*cursor != '\0')
+    {
+        const char* line_end = strchr(cursor, '\n');
+        if(line_end == nullptr) line_end = cursor + strlen(cursor);
+
+        while(*cursor == ' ' || *cursor == '\t') cursor++;
+
+        if(cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            char* end;
+            Vector3f position;
+            Vector3f color = v3f_one();
+
+            cursor += 2;
+            for(int i = 0; i < 3; i++)
+            {
+                position[i] = strtof(cursor, &end);
+                cursor = end;
+            }
+
+            //A fourth number alone is the homogeneous w, which is ignored.
+            //Exactly three more are the vertex color extension.
+            float extra[4];
+            int extra_count = 0;
+
+            while(extra_count < 4)
+            {
+                float value = strtof(cursor, &end);
+                if(end == cursor || end > line_end) break;
+
+                extra[extra_count++] = value;
+                cursor = end;
+            }
+
+            if(extra_count == 3)
+            {
+                color = Vector3f(extra[0], extra[1], extra[2]);
+            }
+
+            positions.push_back(position);
+            colors.push_back(color);
+        }
+        else if(cursor[0] == 'v' && cursor[1] == 't')
+        {
+            char* end;
+            Vector2f tex_coord;
+
+            cursor += 2;
+            tex_coord[0] = strtof(cursor, &end); cursor = end;
+            tex_coord[1] = strtof(cursor, &end); cursor = end;
+
+            tex_coords.push_back(tex_coord);
+        }
+        else if(cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            cursor += 2;
+            face.clear();
+
+            while(cursor < line_end)
+            {
+                while(cursor < line_end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+                if(cursor >= line_end) break;
+
+                int32_t position_index;
+                int32_t tex_coord_index = -1;
+                int32_t unused;
+
+                if(!parse_obj_index(cursor, positions.size(), position_index))
+                {
+                    throw std::runtime_error(std::string("Malformed face in OBJ file: ") + file);
+                }
+
+                if(*cursor == '/')
+                {
+                    cursor++;
+                    if(*cursor != '/') parse_obj_index(cursor, tex_coords.size(), tex_coord_index);
+                    if(*cursor == '/')
+                    {
+                        cursor++;
+                        parse_obj_index(cursor, 0, unused);
+                    }
+                }
+
+                if( position_index < 0 || position_index >= (int32_t)positions.size() ||
+                    tex_coord_index >= (int32_t)tex_coords.size())
+                {
+                    throw std::runtime_error(std::string("Out of range index in OBJ file: ") + file);
+                }
+
+                uint64_t key = (static_cast<uint64_t>(position_index) << 32) | static_cast<uint32_t>(tex_coord_index);
+                auto found = vertex_lookup.find(key);
+
+                if(found == vertex_lookup.end())
+                {
+                    Vertex vertex;
+                    vertex.pos = positions[position_index];
+                    vertex.color = colors[position_index];
+                    vertex.tex_coord = tex_coord_index >= 0 ? tex_coords[tex_coord_index] : Vector2f(0.0f, 0.0f);
+
+                    found = vertex_lookup.emplace(key, vertices.size()).first;
+                    vertices.push_back(vertex);
+                }
+
+                face.push_back(found->second);
+            }
+
+            for(size_t i = 2; i < face.size(); i++)
+            {
+                indices.push_back(face[0]);
+                indices.push_back(face[i - 1]);
+                indices.push_back(face[i]);
+            }
+        }
+
+        cursor = *line_end == '\0' ? line_end : line_end + 1;
+    }
+}
+
+//GLB
+static const uint32_t GLB_MAGIC = 0x46546C67;      //"glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; //"JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;  //"BIN\0"
+
+static const int GLTF_UNSIGNED_BYTE = 5121;
+static const int GLTF_UNSIGNED_SHORT = 5123;
+static const int GLTF_UNSIGNED_INT = 5125;
+static const int GLTF_FLOAT = 5126;
+
+struct GltfAccessorView
+{
+    const uint8_t* ptr_data;
+    size_t count;
+    size_t stride;
+    int component_type;
+    int components;
+    bool normalized;
+};
+
+static int gltf_component_size(int component_type)
+{
+    switch(component_type)
+    {
+        case GLTF_UNSIGNED_BYTE: return 1;
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT: return 4;
+        default: throw std::runtime_error("Unsupported glTF component type.");
+    }
+}
+
+static int gltf_type_components(const std::string& type)
+{
+    if(type == "SCALAR") return 1;
+    if(type == "VEC2") return 2;
+    if(type == "VEC3") return 3;
+    if(type == "VEC4") return 4;
+
+    throw std::runtime_error("Unsupported glTF accessor type.");
+}
+
+//Resolves accessor -> bufferView -> BIN chunk, and checks it all stays inside the chunk.
+//An accessor without a bufferView is all zeros, it reads every element from the same zeros.
+static GltfAccessorView get_gltf_accessor(  const JsonValue& root,
+                                            const std::vector<uint8_t>& bin,
+                                            size_t accessor_index)
+{
+    //Room for the largest element, a VEC4 of floats.
+    static const uint8_t zeros[16] = {};
+
+    const JsonValue* accessors = root.find("accessors");
+
+    if(!accessors || accessor_index >= accessors->size())
+    {
+        throw std::runtime_error("Missing glTF accessor.");
+    }
+
+    const JsonValue& accessor = (*accessors)[accessor_index];
+
+    if(accessor.find("sparse"))
+    {
+        throw std::runtime_error("Sparse glTF accessors are not supported.");
+    }
+
+    GltfAccessorView result;
+    result.component_type = static_cast<int>(accessor.get_number("componentType", 0.0));
+    result.components = gltf_type_components(accessor.get_string("type", ""));
+    result.count = static_cast<size_t>(accessor.get_number("count", 0.0));
+
+    const JsonValue* normalized = accessor.find("normalized");
+    result.normalized = normalized && normalized->type == JSON_BOOL && normalized->boolean;
+
+    size_t element_size = gltf_component_size(result.component_type) * result.components;
+
+    const JsonValue* view_number = accessor.find("bufferView");
+
+    if(!view_number)
+    {
+        result.stride = 0;
+        result.ptr_data = zeros;
+        return result;
+    }
+
+    const JsonValue* buffer_views = root.find("bufferViews");
+
+    if( view_number->type != JSON_NUMBER || view_number->number < 0.0 ||
+        !buffer_views || view_number->number >= static_cast<double>(buffer_views->size()))
+    {
+        throw std::runtime_error("Missing glTF buffer view.");
+    }
+
+    const JsonValue& view = (*buffer_views)[static_cast<size_t>(view_number->number)];
+
+    if(view.get_number("buffer", 0.0) != 0.0)
+    {
+        throw std::runtime_error("Only the GLB binary buffer is supported.");
+    }
+
+    result.stride = static_cast<size_t>(view.get_number("byteStride", static_cast<double>(element_size)));
+
+    size_t offset = static_cast<size_t>(view.get_number("byteOffset", 0.0)) +
+                    static_cast<size_t>(accessor.get_number("byteOffset", 0.0));
+    size_t view_end = static_cast<size_t>(view.get_number("byteOffset", 0.0)) +
+                      static_cast<size_t>(view.get_number("byteLength", 0.0));
+
+    if( result.count > 0 &&
+        (view_end > bin.size() || offset + (result.count - 1) * result.stride + element_size > view_end))
+    {
+        throw std::runtime_error("glTF accessor out of bounds.");
+    }
+
+    result.ptr_data = bin.data() + offset;
+
+    return result;
+}
+
+static float read_gltf_component(const GltfAccessorView& view, size_t element, int component)
+{
+    const uint8_t* ptr = view.ptr_data + element * view.stride;
+
+    switch(view.component_type)
+    {
+        case GLTF_FLOAT:
+        {
+            float value;
+            memcpy(&value, ptr + component * 4, 4);
+            return value;
+        }
+        case GLTF_UNSIGNED_BYTE:
+        {
+            float value = ptr[component];
+            return view.normalized ? value / 255.0f : value;
+        }
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, ptr + component * 2, 2);
+            return view.normalized ? value / 65535.0f : value;
+        }
+        default:
+        {
+            uint32_t value;
+            memcpy(&value, ptr + component * 4, 4);
+            return static_cast<float>(value);
+        }
+    }
+}
+
+static uint32_t read_gltf_index(const GltfAccessorView& view, size_t element)
+{
+    const uint8_t* ptr = view.ptr_data + element * view.stride;
+
+    switch(view.component_type)
+    {
+        case GLTF_UNSIGNED_BYTE: return ptr[0];
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, ptr, 2);
+            return value;
+        }
+        case GLTF_UNSIGNED_INT:
+        {
+            uint32_t value;
+            memcpy(&value, ptr, 4);
+            return value;
+        }
+        default: throw std::runtime_error("Unsupported glTF index type.");
+    }
+}
+
+void load_glb_mesh( const char* file,
+                    std::vector<Vertex>& vertices,
+                    std::vector<uint32_t>& indices)
+{
+    std::vector<char> buffer = read_file(file);
+
+    uint32_t header[3];
+
+    if(buffer.size() < sizeof(header))
+    {
+        throw std::runtime_error(std::string("Truncated GLB file: ") + file);
+    }
+
+    memcpy(header, buffer.data(), sizeof(header));
+
+    if(header[0] != GLB_MAGIC || header[1] != 2)
+    {
+        throw std::runtime_error(std::string("Not a glTF 2.0 binary file: ") + file);
+    }
+
+    const char* ptr_json = nullptr;
+    size_t json_length = 0;
+    std::vector<uint8_t> bin;
+
+    size_t offset = sizeof(header);
+
+    while(offset + 8 <= buffer.size())
+    {
+        uint32_t chunk[2];
+        memcpy(chunk, buffer.data() + offset, sizeof(chunk));
+        offset += 8;
+
+        if(offset + chunk[0] > buffer.size())
+        {
+            throw std::runtime_error(std::string("Truncated GLB chunk: ") + file);
+        }
+
+        if(chunk[1] == GLB_CHUNK_JSON && ptr_json == nullptr)
+        {
+            ptr_json = buffer.data() + offset;
+            json_length = chunk[0];
+        }
+        else if(chunk[1] == GLB_CHUNK_BIN && bin.empty())
+        {
+            bin.assign(buffer.begin() + offset, buffer.begin() + offset + chunk[0]);
+        }
+
+        offset += chunk[0];
+    }
+
+    if(ptr_json == nullptr)
+    {
+        throw std::runtime_error(std::string("GLB file without JSON chunk: ") + file);
+    }
+
+    JsonValue root = json_parse(ptr_json, json_length);
+
+    const JsonValue* meshes = root.find("meshes");
+
+    if(!meshes || meshes->type != JSON_ARRAY)
+    {
+        throw std::runtime_error(std::string("GLB file without meshes: ") + file);
+    }
+
+    for(const JsonValue& mesh : meshes->array)
+    {
+        const JsonValue* primitives = mesh.find("primitives");
+        if(!primitives) continue;
+
+        for(const JsonValue& primitive : primitives->array)
+        {
+            //Triangle lists only, which is also the default mode.
+            if(primitive.get_number("mode", 4.0) != 4.0) continue;
+
+            const JsonValue* attributes = primitive.find("attributes");
+            if(!attributes || !attributes->find("POSITION")) continue;
+
+            GltfAccessorView position = get_gltf_accessor(root, bin, attributes->get_number("POSITION", 0.0));
+
+            if(position.component_type != GLTF_FLOAT || position.components != 3)
+            {
+                throw std::runtime_error(std::string("Unsupported glTF POSITION format: ") + file);
+            }
+
+            uint32_t base_vertex = vertices.size();
+            vertices.resize(base_vertex + position.count);
+
+            for(size_t v = 0; v < position.count; v++)
+            {
+                Vertex& vertex = vertices[base_vertex + v];
+
+                for(int i = 0; i < 3; i++)
+                {
+                    vertex.pos[i] = read_gltf_component(position, v, i);
+                }
+
+                vertex.color = v3f_one();
+                vertex.tex_coord = Vector2f(0.0f, 0.0f);
+            }
+
+            if(attributes->find("COLOR_0"))
+            {
+                GltfAccessorView color = get_gltf_accessor(root, bin, attributes->get_number("COLOR_0", 0.0));
+                //Colors are always normalized when stored as integers.
+                color.normalized = true;
+
+                for(size_t v = 0; v < std::min(color.count, position.count); v++)
+                {
+                    for(int i = 0; i < 3; i++)
+                    {
+                        vertices[base_vertex + v].color[i] = read_gltf_component(color, v, i);
+                    }
+                }
+            }
+
+            if(attributes->find("TEXCOORD_0"))
+            {
+                GltfAccessorView tex_coord = get_gltf_accessor(root, bin, attributes->get_number("TEXCOORD_0", 0.0));
+
+                //VEC2 of floats, or of normalized bytes or shorts.
+                bool tex_coord_normalized = tex_coord.normalized &&
+                                            (tex_coord.component_type == GLTF_UNSIGNED_BYTE ||
+                                             tex_coord.component_type == GLTF_UNSIGNED_SHORT);
+
+                if(tex_coord.components != 2 || (tex_coord.component_type != GLTF_FLOAT && !tex_coord_normalized))
+                {
+                    throw std::runtime_error(std::string("Unsupported glTF TEXCOORD_0 format: ") + file);
+                }
+
+                for(size_t v = 0; v < std::min(tex_coord.count, position.count); v++)
+                {
+                    vertices[base_vertex + v].tex_coord = Vector2f(read_gltf_component(tex_coord, v, 0),
+                                                                   read_gltf_component(tex_coord, v, 1));
+                }
+            }
+
+            if(primitive.find("indices"))
+            {
+                GltfAccessorView index = get_gltf_accessor(root, bin, primitive.get_number("indices", 0.0));
+
+                for(size_t i = 0; i + 2 < index.count; i += 3)
+                {
+                    for(int k = 0; k < 3; k++)
+                    {
+                        uint32_t value = read_gltf_index(index, i + k);
+
+                        if(value >= position.count)
+                        {
+                            throw std::runtime_error(std::string("Out of range index in GLB file: ") + file);
+                        }
+
+                        indices.push_back(base_vertex + value);
+                    }
+                }
+            }
+            else
+            {
+                for(uint32_t i = 0; i + 2 < position.count; i += 3)
+                {
+                    indices.push_back(base_vertex + i);
+                    indices.push_back(base_vertex + i + 1);
+                    indices.push_back(base_vertex + i + 2);
+                }
+            }
+        }
+    }
+}
+
+void load_mesh_file(const char* file,
+                    std::vector<Vertex>& vertices,
+                    std::vector<uint32_t>& indices)
+{
+    std::string name(file);
+    std::string extension = name.substr(name.find_last_of('.') + 1);
+
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if(extension == "obj")
+    {
+        load_obj_mesh(file, vertices, indices);
+    }
+    else if(extension == "glb")
+    {
+        load_glb_mesh(file, vertices, indices);
+    }
+    else
+    {
+        throw std::runtime_error(std::string("Unknown mesh file type: ") + file);
+    }
+}
@@ -0,0 +1,123 @@
+#include "Vulkan.hpp"
+#include "TextureCodec.hpp"
+
+void VulkanOverdraw::add_frame(const VulkanSpriteQueue& queue, VkExtent2D t_extent, VkFormat target_format)
+{
+    layer_stats.clear();
+
+    if(!enabled && !heatmap)
+    {
+        return;
+    }
+
+    extent = t_extent;
+
+    if(heatmap)
+    {
+        write_counts.assign(size_t(extent.width) * extent.height, 0);
+    }
+
+    int32_t width = static_cast<int32_t>(extent.width);
+    int32_t height = static_cast<int32_t>(extent.height);
+
+    for(uint32_t i = 0; i < queue.count; i++)
+    {
+        const VulkanSprite& sprite = queue.get_sorted(i);
+
+        int32_t x0 = std::max(sprite.destination.offset.x, 0);
+        int32_t y0 = std::max(sprite.destination.offset.y, 0);
+        int32_t x1 = std::min(sprite.destination.offset.x + static_cast<int32_t>(sprite.destination.extent.width), width);
+        int32_t y1 = std::min(sprite.destination.offset.y + static_cast<int32_t>(sprite.destination.extent.height), height);
+
+        if(x0 >= x1 || y0 >= y1 || sprite.source.extent.width == 0 || sprite.source.extent.height == 0)
+        {
+            continue;
+        }
+
+        //Keys are sorted, so sprites of a layer come one after another.
+        uint32_t layer = static_cast<uint32_t>(queue.ptr_keys[i] >> (64 - SPRITE_KEY_LAYER_BITS));
+
+        if(layer_stats.empty() || layer_stats.back().layer != layer)
+        {
+            layer_stats.push_back(VulkanLayerStats());
+            layer_stats.back().layer = layer;
+        }
+
+        uint32_t clip_width = static_cast<uint32_t>(x1 - x0);
+        uint32_t clip_height = static_cast<uint32_t>(y1 - y0);
+
+        //The texels read shrink with the part of the sprite left on the target.
+        uint32_t mip_level = get_sprite_mip_level(sprite);
+        uint64_t src_width = std::max(sprite.source.extent.width >> mip_level, 1u);
+        uint64_t src_height = std::max(sprite.source.extent.height >> mip_level, 1u);
+        uint32_t read_width = static_cast<uint32_t>((src_width * clip_width + sprite.destination.extent.width - 1) / sprite.destination.extent.width);
+        uint32_t read_height = static_cast<uint32_t>((src_height * clip_height + sprite.destination.extent.height - 1) / sprite.destination.extent.height);
+
+        VulkanLayerStats& stats = layer_stats.back();
+        stats.sprite_count++;
+        stats.pixels_touched += uint64_t(clip_width) * clip_height;
+        stats.bytes_moved +=    get_image_size(sprite.ptr_texture->image_format, read_width, read_height) +
+                                get_image_size(target_format, clip_width, clip_height);
+
+        if(!heatmap)
+        {
+            continue;
+        }
+
+        for(int32_t y = y0; y < y1; y++)
+        {
+            uint16_t* ptr_row = write_counts.data() + size_t(y) * extent.width;
+
+            for(int32_t x = x0; x < x1; x++)
+            {
+                ptr_row[x] += ptr_row[x] < UINT16_MAX;
+            }
+        }
+    }
+}
+
+const VulkanLayerStats* VulkanOverdraw::find_layer(uint32_t layer) const
+{
+    for(const VulkanLayerStats& stats : layer_stats)
+    {
+        if(stats.layer == layer)
+        {
+            return &stats;
+        }
+    }
+
+    return nullptr;
+}
+
+void VulkanOverdraw::write_heatmap(uint32_t* ptr_pixels, bool bgra) const
+{
+    //RGB by write count, the last one for OVERDRAW_HEATMAP_LEVELS and more.
+    static const uint8_t ramp[OVERDRAW_HEATMAP_LEVELS + 1][3] =
+    {
+        {0, 0, 0},
+        {0, 0, 160},
+        {0, 128, 255},
+        {0, 192, 0},
+        {192, 224, 0},
+        {255, 192, 0},
+        {255, 96, 0},
+        {224, 0, 0},
+        {255, 255, 255}
+    };
+
+    uint32_t colors[OVERDRAW_HEATMAP_LEVELS + 1];
+
+    for(uint32_t i = 0; i <= OVERDRAW_HEATMAP_LEVELS; i++)
+    {
+        //Little endian, so the first byte in memory is the lowest.
+        uint32_t first = bgra ? ramp[i][2] : ramp[i][0];
+        uint32_t third = bgra ? ramp[i][0] : ramp[i][2];
+
+        colors[i] = 0xff000000u | (third << 16) | (uint32_t(ramp[i][1]) << 8) | first;
+    }
+
+    for(size_t i = 0; i < write_counts.size(); i++)
+    {
+        ptr_pixels[i] = colors[std::min<uint32_t>(write_counts[i], OVERDRAW_HEATMAP_LEVELS)];
+    }
+}
@@ -123,7 +123,9 @@ void Vulkan::create_swap_chain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 
     createInfo.presentMode = presentMode;
-    createInfo.clipped = VK_TRUE;
+    //Partial redraws present pixels written frames ago, so obscured ones have to be kept too.
+    createInfo.clipped = VK_FALSE;
+    swap_chain_clipped = createInfo.clipped == VK_TRUE;
 
     if(vkCreateSwapchainKHR(logical_device, &createInfo, nullptr, &swap_chain) != VK_SUCCESS)
     {
@@ -236,6 +238,104 @@ void Vulkan::create_render_targets()
     }
 }
 
+//Picks the smallest depth format usable as an attachment, there is no stencil use.
+VkFormat Vulkan::find_depth_format()
+{
+    VkFormat candidates[] = {VK_FORMAT_D16_UNORM, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D32_SFLOAT};
+
+    for(VkFormat format : candidates)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+        if(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a depth format.");
+}
+
+//Creates a depth buffer for each render target. Depth is cleared on load and never stored,
+//so on tiled GPUs lazily allocated memory never has to be backed at all.
+void Vulkan::create_depth_targets()
+{
+    depth_format = find_depth_format();
+
+    depth_images.resize(render_target_images.size());
+    depth_images_memory.resize(render_target_images.size());
+    depth_image_views.resize(render_target_images.size());
+
+    for(size_t i = 0; i < depth_images.size(); i++)
+    {
+        VkImageCreateInfo create_info = {};
+        create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        create_info.imageType = VK_IMAGE_TYPE_2D;
+        create_info.format = depth_format;
+        create_info.extent = {render_target_image_extent.width, render_target_image_extent.height, 1};
+        create_info.mipLevels = 1;
+        create_info.arrayLayers = 1;
+        create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        create_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(logical_device, &create_info, nullptr, &depth_images[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create depth images.");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(logical_device, depth_images[i], &memRequirements);
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &memProperties);
+
+        //Desktop GPUs have no lazily allocated memory, plain device memory does the job there.
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        for(uint32_t t = 0; t < memProperties.memoryTypeCount; t++)
+        {
+            if( (memRequirements.memoryTypeBits & (1 << t)) &&
+                (memProperties.memoryTypes[t].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+            {
+                properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+                break;
+            }
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = find_memory_type(physical_device, memRequirements.memoryTypeBits, properties);
+
+        if (vkAllocateMemory(logical_device, &allocInfo, nullptr, &depth_images_memory[i]) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("Failed to allocate depth image memory.");
+        }
+
+        vkBindImageMemory(logical_device, depth_images[i], depth_images_memory[i], 0);
+
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = depth_images[i];
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = depth_format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(logical_device, &view_info, nullptr, &depth_image_views[i]) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("Failed to create depth image views.");
+        }
+    }
+}
+
 //GRAPHICS PIPELINE
 //TODO: Better Documentation
 //Creates the Render Pass
@@ -251,27 +351,46 @@ void Vulkan::create_render_pass()
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
+    //Cleared every pass and thrown away after it.
+    VkAttachmentDescription depthAttachment = {};
+    depthAttachment.format = depth_format;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depthAttachmentRef = {};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass = {};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+    //The depth clear waits on the previous pass using the same image being done with it.
     VkSubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
 
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
     renderPassInfo.dependencyCount = 1;
@@ -308,8 +427,8 @@ void Vulkan::create_graphics_pipeline()
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto binding_description = Vertex::get_binding_description();
-    auto attribute_descriptions = Vertex::get_attribute_descriptions();
+    auto binding_description = get_vertex_binding_description(vertex_format);
+    auto attribute_descriptions = get_vertex_attribute_descriptions(vertex_format);
 
     //Tells the pipeline to not care about vertex input. Since we are using hard coded vertexes.
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
@@ -393,6 +512,16 @@ void Vulkan::create_graphics_pipeline()
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
+    //Opaque draws come front to back, so anything behind them fails the depth test
+    //before its fragment shader runs.
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
     //Creates the pipeline layout.
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -416,7 +545,7 @@ void Vulkan::create_graphics_pipeline()
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = nullptr; // Optional
     pipelineInfo.layout = pipeline_layout;
@@ -430,11 +559,74 @@ void Vulkan::create_graphics_pipeline()
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
 
+    //Transparent draws blend back to front over the opaque ones, tested against their depth
+    //but without writing it so they never hide each other.
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    depthStencil.depthWriteEnable = VK_FALSE;
+
+    if (vkCreateGraphicsPipelines(logical_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &transparent_pipeline) != VK_SUCCESS)
+    { 
+        throw std::runtime_error("Failed to create transparent graphics pipeline!");
+    }
+
     //Destroys no longer needed shader modules, since they were already uploaded to the gpu.
     vkDestroyShaderModule(logical_device, fragShaderModule, nullptr); 
     vkDestroyShaderModule(logical_device, vertShaderModule, nullptr); 
 }
 
+//Creates the compute pipeline that culls the scene objects and writes their indirect draws.
+void Vulkan::create_cull_pipeline()
+{
+    if(!gpu_culling_supported)
+    {
+        return;
+    }
+
+    auto cullShaderBytecode = read_file("shaders/cull.spv");
+
+    VkShaderModule cullShaderModule = create_shader_module(cullShaderBytecode);
+
+    VkPipelineShaderStageCreateInfo cullShaderStageInfo = {};
+    cullShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    cullShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullShaderStageInfo.module = cullShaderModule;
+    cullShaderStageInfo.pName = "main";
+
+    VkPushConstantRange push_constant_range = {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(CullConstants);
+
+    //Shares the descriptor sets with the graphics pipeline.
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptor_set_layout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(logical_device, &pipelineLayoutInfo, nullptr, &cull_pipeline_layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create cull pipeline layout.");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = cullShaderStageInfo;
+    pipelineInfo.layout = cull_pipeline_layout;
+
+    if (vkCreateComputePipelines(logical_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &cull_pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create cull pipeline!");
+    }
+
+    vkDestroyShaderModule(logical_device, cullShaderModule, nullptr);
+}
+
 //Creates the Framebuffer for every render_target image.
 void Vulkan::create_framebuffers() 
 {
@@ -444,13 +636,14 @@ void Vulkan::create_framebuffers()
     {
         VkImageView attachments[] = 
         {
-            render_target_image_views[i]
+            render_target_image_views[i],
+            depth_image_views[i]
         };
 
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = render_pass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = 2;
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = render_target_image_extent.width;
         framebufferInfo.height = render_target_image_extent.height;
@@ -0,0 +1,158 @@
+#include "Vulkan.hpp"
+
+uint32_t VulkanScene::add_object(VulkanMesh* ptr_mesh, const Affine3f& transform)
+{
+    meshes.push_back(ptr_mesh);
+    transforms.push_back(transform);
+    nodes.push_back(NO_NODE);
+    opacities.push_back(1.0f);
+    lods.push_back(0);
+    generation++;
+
+    return meshes.size() - 1;
+}
+
+void VulkanScene::set_transform(uint32_t object, const Affine3f& transform)
+{
+    transforms[object] = transform;
+    generation++;
+}
+
+void VulkanScene::move_object(uint32_t object, const Affine3f& transform)
+{
+    transforms[object] = transform;
+    moved_objects.push_back(object);
+}
+
+void VulkanScene::set_opacity(uint32_t object, float opacity)
+{
+    opacities[object] = opacity;
+    generation++;
+}
+
+void VulkanScene::attach_to_node(uint32_t object, uint32_t node, const TransformHierarchy& hierarchy)
+{
+    nodes[object] = node;
+    transforms[object] = hierarchy.world_transforms[node];
+    generation++;
+}
+
+void VulkanScene::update_transforms(const TransformHierarchy& hierarchy)
+{
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i] != NO_NODE && hierarchy.changed[nodes[i]])
+        {
+            move_object(i, hierarchy.world_transforms[nodes[i]]);
+        }
+    }
+}
+
+//Builds the GPU side view of one object.
+static VulkanObjectData get_object_data(VulkanMesh* ptr_mesh, const Affine3f& transform, float opacity, uint32_t batch, uint32_t object)
+{
+    VulkanObjectData data = {};
+    data.model = transform * ptr_mesh->dequantize;
+
+    Vector3f center = (ptr_mesh->bounds_min + ptr_mesh->bounds_max) * 0.5f;
+    float radius = (ptr_mesh->bounds_max - ptr_mesh->bounds_min).length() * 0.5f;
+
+    data.bounding_sphere = Vector4f(a3f_transform_point(transform, center), radius * a3f_max_scale(transform));
+    data.batch = batch;
+    data.opacity = opacity;
+    data.object = object;
+
+    return data;
+}
+
+void VulkanScene::update_object_data(uint32_t object, VulkanObjectData& data) const
+{
+    data = get_object_data(meshes[object], transforms[object], opacities[object], data.batch, object);
+}
+
+uint32_t VulkanScene::gather_objects(   std::vector<VulkanObjectData>& objects,
+                                        std::vector<VulkanBatch>& batches) const
+{
+    std::vector<uint32_t> order;
+    order.reserve(meshes.size());
+
+    for(uint32_t i = 0; i < meshes.size(); i++)
+    {
+        if(meshes[i]->state == MESH_RESIDENT)
+        {
+            order.push_back(i);
+        }
+    }
+
+    //Blending first, then mesh, a mesh is identified by its index range and index type.
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+    {
+        const VulkanMesh* ptr_a = meshes[a];
+        const VulkanMesh* ptr_b = meshes[b];
+
+        bool a_transparent = opacities[a] < 1.0f;
+        bool b_transparent = opacities[b] < 1.0f;
+
+        if(a_transparent != b_transparent) return b_transparent;
+        if(ptr_a->index_type != ptr_b->index_type) return ptr_a->index_type < ptr_b->index_type;
+        if(ptr_a->first_index != ptr_b->first_index) return ptr_a->first_index < ptr_b->first_index;
+        return a < b;
+    });
+
+    objects.clear();
+    batches.clear();
+
+    uint32_t instance_slots = 0;
+
+    for(size_t first = 0; first < order.size();)
+    {
+        const VulkanMesh* ptr_mesh = meshes[order[first]];
+        bool transparent = opacities[order[first]] < 1.0f;
+
+        size_t end = first + 1;
+
+        //Transparent objects are a group each, so every one of them is sorted by its own depth.
+        while(  !transparent &&
+                end < order.size() &&
+                meshes[order[end]] == ptr_mesh &&
+                (opacities[order[end]] < 1.0f) == transparent)
+        {
+            end++;
+        }
+
+        uint32_t first_batch = batches.size();
+        float radius = std::max((ptr_mesh->bounds_max - ptr_mesh->bounds_min).length() * 0.5f, FLT_MIN);
+
+        for(uint32_t l = 0; l < ptr_mesh->lod_count; l++)
+        {
+            VulkanBatch batch = {};
+            batch.draw.indexCount = ptr_mesh->lods[l].index_count;
+            batch.draw.instanceCount = 0;
+            batch.draw.firstIndex = ptr_mesh->lods[l].first_index;
+            batch.draw.vertexOffset = ptr_mesh->vertex_offset;
+            batch.draw.firstInstance = instance_slots;
+            batch.index_type = ptr_mesh->index_type;
+            batch.transparent = transparent;
+            batch.first_object = objects.size();
+            batch.object_count = end - first;
+            batch.lod = l;
+            batch.lod_count = ptr_mesh->lod_count;
+            batch.lod_error = ptr_mesh->lods[l].error / radius;
+
+            batches.push_back(batch);
+            instance_slots += end - first;
+        }
+
+        for(size_t i = first; i < end; i++)
+        {
+            uint32_t object = order[i];
+            uint32_t lod = std::min<uint32_t>(lods[object], ptr_mesh->lod_count - 1);
+
+            objects.push_back(get_object_data(meshes[object], transforms[object], opacities[object], first_batch + lod, object));
+        }
+
+        first = end;
+    }
+
+    return instance_slots;
+}
@@ -11,29 +11,279 @@ VulkanSprite::VulkanSprite(	VulkanTexture* t_ptr_texture,
 	pixel_perfect = t_pixel_perfect;
 }
 
-void VulkanSpriteQueue::queue_sprite(	VulkanSprite* ptr_sprite, 
+//A word at a time, multiply and fold, cheap enough to run on every queued sprite.
+uint64_t hash_sprite(const VulkanSprite& sprite, uint64_t key, uint64_t hash)
+{
+	auto mix = [&hash](uint64_t word)
+	{
+		hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+		hash ^= hash >> 32;
+	};
+
+	auto pack = [](int32_t low, uint32_t high)
+	{
+		return uint64_t(static_cast<uint32_t>(low)) | (uint64_t(high) << 32);
+	};
+
+	mix(key >> SPRITE_KEY_INDEX_BITS);
+	mix(sprite.ptr_texture->id);
+	mix(pack(sprite.source.offset.x, static_cast<uint32_t>(sprite.source.offset.y)));
+	mix(pack(static_cast<int32_t>(sprite.source.extent.width), sprite.source.extent.height));
+	mix(pack(sprite.destination.offset.x, static_cast<uint32_t>(sprite.destination.offset.y)));
+	mix(pack(static_cast<int32_t>(sprite.destination.extent.width), sprite.destination.extent.height));
+
+	return hash;
+}
+
+uint32_t get_sprite_mip_level(const VulkanSprite& sprite)
+{
+	uint32_t mip_level = 0;
+
+	while(	mip_level + 1 < sprite.ptr_texture->mip_levels &&
+			sprite.destination.extent.width * 2 <= (sprite.source.extent.width >> mip_level) &&
+			sprite.destination.extent.height * 2 <= (sprite.source.extent.height >> mip_level))
+	{
+		mip_level++;
+	}
+
+	return mip_level;
+}
+
+//Makes room for more sprites.
+void VulkanSpriteQueue::reserve(uint32_t more)
+{
+	if(count + more <= capacity)
+	{
+		return;
+	}
+
+	if(count + more > (1u << SPRITE_KEY_INDEX_BITS))
+	{
+		throw std::runtime_error("Too many sprites queued in one frame.");
+	}
+
+	uint32_t new_capacity = std::max(capacity * 2, 256u);
+
+	while(new_capacity < count + more)
+	{
+		new_capacity *= 2;
+	}
+
+	VulkanSprite* ptr_new_sprites = ptr_arena->allocate_array<VulkanSprite>(new_capacity);
+	uint64_t* ptr_new_keys = ptr_arena->allocate_array<uint64_t>(new_capacity);
+
+	if(count > 0)
+	{
+		memcpy(ptr_new_sprites, ptr_sprites, count * sizeof(VulkanSprite));
+		memcpy(ptr_new_keys, ptr_keys, count * sizeof(uint64_t));
+	}
+
+	ptr_sprites = ptr_new_sprites;
+	ptr_keys = ptr_new_keys;
+	capacity = new_capacity;
+}
+
+//Texture ids wrap around past their bits, which only costs some grouping.
+uint64_t VulkanSpriteQueue::get_sort_key(const VulkanSprite& sprite, uint32_t layer, uint32_t index)
+{
+	if(layer >= (1u << SPRITE_KEY_LAYER_BITS))
+	{
+		throw std::runtime_error("Sprite layer out of range.");
+	}
+
+	uint64_t texture = sprite.ptr_texture->id & ((1u << SPRITE_KEY_TEXTURE_BITS) - 1);
+	uint64_t filter = sprite.pixel_perfect ? 0 : 1;
+
+	return	(uint64_t(layer) << (64 - SPRITE_KEY_LAYER_BITS)) |
+			(filter << (SPRITE_KEY_TEXTURE_BITS + SPRITE_KEY_INDEX_BITS)) |
+			(texture << SPRITE_KEY_INDEX_BITS) |
+			index;
+}
+
+void VulkanSpriteQueue::queue_sprite(	const VulkanSprite& sprite, 
 										uint32_t layer)
 {
-	if(layer >= queued_layers)
+	reserve(1);
+
+	ptr_sprites[count] = sprite;
+	ptr_keys[count] = get_sort_key(sprite, layer, count);
+	hash = hash_sprite(sprite, ptr_keys[count], hash);
+	count++;
+}
+
+//Appends a whole run at once moved by offset, used for prebuilt text.
+void VulkanSpriteQueue::queue_sprites(	const std::vector<VulkanSprite>& sprites,
+										uint32_t layer,
+										const VkOffset2D& offset)
+{
+	reserve(sprites.size());
+
+	for(const VulkanSprite& sprite : sprites)
 	{
-		queue.resize(layer + 1);
-		queued_layers = layer;
+		ptr_sprites[count] = sprite;
+		ptr_sprites[count].destination.offset.x += offset.x;
+		ptr_sprites[count].destination.offset.y += offset.y;
+		ptr_keys[count] = get_sort_key(ptr_sprites[count], layer, count);
+		hash = hash_sprite(ptr_sprites[count], ptr_keys[count], hash);
+		count++;
 	}
+}
 
-	(queue[layer]).push_back(ptr_sprite);
+//LSD radix sort, a byte per pass. Passes where every key has the same byte are skipped,
+//which is most of them: the index bytes are always spread, layers and textures rarely are.
+void VulkanSpriteQueue::sort()
+{
+	if(count < 2)
+	{
+		return;
+	}
+
+	uint64_t* ptr_scratch = ptr_arena->allocate_array<uint64_t>(count);
+	uint64_t* ptr_src = ptr_keys;
+	uint64_t* ptr_dst = ptr_scratch;
+
+	//The index bytes are already in order since keys are queued by index.
+	for(uint32_t shift = SPRITE_KEY_INDEX_BITS; shift < 64; shift += 8)
+	{
+		uint32_t histogram[256] = {};
+
+		for(uint32_t i = 0; i < count; i++)
+		{
+			histogram[(ptr_src[i] >> shift) & 0xff]++;
+		}
+
+		if(histogram[(ptr_src[0] >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+
+		for(uint32_t& bucket : histogram)
+		{
+			uint32_t bucket_count = bucket;
+			bucket = offset;
+			offset += bucket_count;
+		}
+
+		for(uint32_t i = 0; i < count; i++)
+		{
+			ptr_dst[histogram[(ptr_src[i] >> shift) & 0xff]++] = ptr_src[i];
+		}
+
+		std::swap(ptr_src, ptr_dst);
+	}
+
+	if(ptr_src != ptr_keys)
+	{
+		memcpy(ptr_keys, ptr_src, count * sizeof(uint64_t));
+	}
 }
 
-void VulkanSpriteQueue::clear_queue()
+//Blits overwrite everything under them whatever its alpha, so a sprite is hidden once the
+//sprites drawn after it cover its part of the target. The sorted keys are walked from the top
+//down, every sprite left marks the cells of a coarse grid it covers whole, cells cut by the
+//edge of the target counting as whole. A sprite with every cell it touches marked is dropped.
+//Marking whole cells only keeps it conservative, at worst a hidden sprite is drawn anyway.
+void VulkanSpriteQueue::cull_hidden(VkExtent2D extent)
 {
-	for(auto layer : queue)
+	if(count == 0)
+	{
+		return;
+	}
+
+	int32_t width = static_cast<int32_t>(extent.width);
+	int32_t height = static_cast<int32_t>(extent.height);
+	uint32_t cells_x = (extent.width + SPRITE_CULL_CELL_SIZE - 1) / SPRITE_CULL_CELL_SIZE;
+	uint32_t cells_y = (extent.height + SPRITE_CULL_CELL_SIZE - 1) / SPRITE_CULL_CELL_SIZE;
+
+	uint8_t* ptr_covered = ptr_arena->allocate_array<uint8_t>(cells_x * cells_y);
+	uint8_t* ptr_visible = ptr_arena->allocate_array<uint8_t>(count);
+	memset(ptr_covered, 0, cells_x * cells_y);
+
+	uint32_t visible_count = 0;
+
+	for(uint32_t i = count; i-- > 0;)
+	{
+		const VulkanSprite& sprite = get_sorted(i);
+
+		int32_t x0 = std::max(sprite.destination.offset.x, 0);
+		int32_t y0 = std::max(sprite.destination.offset.y, 0);
+		int32_t x1 = std::min(sprite.destination.offset.x + static_cast<int32_t>(sprite.destination.extent.width), width);
+		int32_t y1 = std::min(sprite.destination.offset.y + static_cast<int32_t>(sprite.destination.extent.height), height);
+
+		ptr_visible[i] = 0;
+
+		if(x0 >= x1 || y0 >= y1 || sprite.source.extent.width == 0 || sprite.source.extent.height == 0)
+		{
+			continue;
+		}
+
+		uint32_t touch_x0 = x0 / SPRITE_CULL_CELL_SIZE;
+		uint32_t touch_y0 = y0 / SPRITE_CULL_CELL_SIZE;
+		uint32_t touch_x1 = (x1 - 1) / SPRITE_CULL_CELL_SIZE + 1;
+		uint32_t touch_y1 = (y1 - 1) / SPRITE_CULL_CELL_SIZE + 1;
+
+		bool hidden = true;
+
+		for(uint32_t y = touch_y0; y < touch_y1 && hidden; y++)
+		{
+			for(uint32_t x = touch_x0; x < touch_x1 && hidden; x++)
+			{
+				hidden = ptr_covered[y * cells_x + x] != 0;
+			}
+		}
+
+		if(hidden)
+		{
+			continue;
+		}
+
+		ptr_visible[i] = 1;
+		visible_count++;
+
+		uint32_t cover_x0 = (x0 + SPRITE_CULL_CELL_SIZE - 1) / SPRITE_CULL_CELL_SIZE;
+		uint32_t cover_y0 = (y0 + SPRITE_CULL_CELL_SIZE - 1) / SPRITE_CULL_CELL_SIZE;
+		uint32_t cover_x1 = x1 == width ? cells_x : x1 / SPRITE_CULL_CELL_SIZE;
+		uint32_t cover_y1 = y1 == height ? cells_y : y1 / SPRITE_CULL_CELL_SIZE;
+
+		for(uint32_t y = cover_y0; y < cover_y1 && cover_x0 < cover_x1; y++)
+		{
+			memset(ptr_covered + y * cells_x + cover_x0, 1, cover_x1 - cover_x0);
+		}
+	}
+
+	if(visible_count == count)
 	{
-		for(auto ptr_sprite : layer)
+		return;
+	}
+
+	//Survivors move to new arrays in draw order, indexing them by position keeps the keys sorted.
+	VulkanSprite* ptr_new_sprites = ptr_arena->allocate_array<VulkanSprite>(capacity);
+	uint64_t* ptr_new_keys = ptr_arena->allocate_array<uint64_t>(capacity);
+	uint32_t kept = 0;
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(ptr_visible[i])
 		{
-			delete ptr_sprite;
+			ptr_new_sprites[kept] = get_sorted(i);
+			ptr_new_keys[kept] = (ptr_keys[i] & ~SPRITE_KEY_INDEX_MASK) | kept;
+			kept++;
 		}
-		
-		layer.clear();
 	}
 
-	queue.clear();
+	ptr_sprites = ptr_new_sprites;
+	ptr_keys = ptr_new_keys;
+	count = kept;
+}
+
+//The arrays themselves go with the arena reset.
+void VulkanSpriteQueue::clear_queue()
+{
+	ptr_sprites = nullptr;
+	ptr_keys = nullptr;
+	count = 0;
+	capacity = 0;
+	hash = SPRITE_HASH_SEED;
 }
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "Vulkan.hpp"
 #include "VulkanTexture.hpp"
+#include "Ktx2.hpp"
+#include "AssetPack.hpp"
+#include "TextureCodec.hpp"
+#include "PixelConvert.hpp"
+
+#include <atomic>
 
 void Vulkan::create_texture_sampler()
 {
@@ -19,7 +25,7 @@ void Vulkan::create_texture_sampler()
 	sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	sampler_info.mipLodBias = 0.0f;
 	sampler_info.minLod = 0.0f;
-	sampler_info.maxLod = 0.0f;
+	sampler_info.maxLod = VK_LOD_CLAMP_NONE;
 
 	 if (vkCreateSampler(logical_device, &sampler_info, nullptr, &texture_sampler) != VK_SUCCESS) 
 	 {
@@ -27,18 +33,125 @@ void Vulkan::create_texture_sampler()
     }
 }
 
+//Textures are drawn by blitting and sampled by meshes, the format has to allow both.
+bool Vulkan::is_texture_format_supported(VkFormat format)
+{
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(physical_device, format, &format_properties);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT;
+
+	return (format_properties.optimalTilingFeatures & required) == required;
+}
+
+
+//Fills mip levels 1 to mip_levels - 1 from level 0, which must hold the image in
+//TRANSFER_DST_OPTIMAL like every other level. Each level is a 2x2 box filtered blit of
+//the one above it. Every level ends up in TRANSFER_SRC_OPTIMAL.
+void Vulkan::exec_generate_mipmaps_cmd(	VkImage image, VkFormat format,
+										uint32_t width, uint32_t height,
+										uint32_t mip_levels)
+{
+	//Without linear filtering a nearest blit still halves the image, just without averaging.
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(physical_device, format, &format_properties);
+
+	VkFilter filter = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ?
+						VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkCommandBuffer command_buffer = begin_one_time_commands();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	int32_t mip_width = width;
+	int32_t mip_height = height;
+
+	for(uint32_t level = 1; level < mip_levels; level++)
+	{
+		//The level above is done being written, it becomes the blit source.
+		barrier.subresourceRange.baseMipLevel = level - 1;
+
+		vkCmdPipelineBarrier(	command_buffer,
+								VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+								0,
+								0, nullptr,
+								0, nullptr,
+								1, &barrier);
+
+		int32_t next_width = std::max(mip_width / 2, 1);
+		int32_t next_height = std::max(mip_height / 2, 1);
+
+		VkImageBlit image_blit = {};
+		image_blit.srcSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+		image_blit.srcSubresource.mipLevel = level - 1;
+		image_blit.srcOffsets[0] = {0, 0, 0};
+		image_blit.srcOffsets[1] = {mip_width, mip_height, 1};
+		image_blit.dstSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+		image_blit.dstSubresource.mipLevel = level;
+		image_blit.dstOffsets[0] = {0, 0, 0};
+		image_blit.dstOffsets[1] = {next_width, next_height, 1};
+
+		vkCmdBlitImage(	command_buffer,
+						image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						1, &image_blit,
+						filter);
+
+		mip_width = next_width;
+		mip_height = next_height;
+	}
+
+	//The last level was only ever written.
+	barrier.subresourceRange.baseMipLevel = mip_levels - 1;
+
+	vkCmdPipelineBarrier(	command_buffer,
+							VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							0,
+							0, nullptr,
+							0, nullptr,
+							1, &barrier);
+
+	end_one_time_commands(command_buffer);
+}
+
+uint32_t allocate_texture_id()
+{
+	static std::atomic<uint32_t> next_id{0};
+	return next_id++;
+}
 
 //Creates a Vulkan Texture object, loading from the file specified.
 VulkanTexture::VulkanTexture(	Vulkan* vulkan,
-								const char* texture_file)
+								const char* texture_file,
+								bool generate_mipmaps)
 {
 	vulkan_instance = vulkan;
-	image_format = VK_FORMAT_B8G8R8A8_SRGB;
-	
+
+	std::string name(texture_file);
+	std::string extension = name.substr(name.find_last_of('.') + 1);
+
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if(extension == "ktx2")
+	{
+		load_ktx2_texture(texture_file, generate_mipmaps);
+		return;
+	}
+
 	//Loads image file
 	SDL_Surface* img_surface = IMG_Load(texture_file);
-	uint32_t width = img_surface->w;
-	uint32_t height = img_surface->h;
 
 	if(img_surface == NULL)
 	{
@@ -46,66 +159,244 @@ VulkanTexture::VulkanTexture(	Vulkan* vulkan,
 		throw std::runtime_error("Error opening texture file.");
 	}
 
-	SDL_PixelFormat* sdl_format = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
-	
-	//Converts file to specified format.
-	SDL_Surface* converted_surface = SDL_ConvertSurface(img_surface, sdl_format, 0);
-
-	if(converted_surface == NULL)
+	//Common decoder outputs are converted straight into staging,
+	//anything else goes through SDL first.
+	if(!can_convert_surface_to_bgra8(img_surface))
 	{
-		std::cerr << "Error converting texture file to RGBA8888: " << texture_file << " " << SDL_GetError() << std::endl;
-		throw std::runtime_error("Error converting texture file.");
+		SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(img_surface, SDL_PIXELFORMAT_BGRA32, 0);
+		SDL_FreeSurface(img_surface);
+
+		if(converted_surface == NULL)
+		{
+			std::cerr << "Error converting texture file to BGRA32: " << texture_file << " " << SDL_GetError() << std::endl;
+			throw std::runtime_error("Error converting texture file.");
+		}
+
+		img_surface = converted_surface;
 	}
 
-	//Frees now unneeded memory.
-	SDL_FreeFormat(sdl_format);
+	image_format = VK_FORMAT_B8G8R8A8_SRGB;
+
+	upload(	img_surface->w, img_surface->h,
+			1, generate_mipmaps,
+			[img_surface](uint8_t* ptr_staging) { convert_surface_to_bgra8(img_surface, ptr_staging); });
+
 	SDL_FreeSurface(img_surface);
+}
+
+//Loads a texture baked by the asset cooker. The pack already holds the exact bytes
+//upload() puts in staging, they are copied straight out of the mapping.
+VulkanTexture::VulkanTexture(	Vulkan* vulkan,
+								const AssetPack& asset_pack,
+								const char* name,
+								bool generate_mipmaps)
+{
+	vulkan_instance = vulkan;
+
+	const AssetPackEntry* ptr_entry = asset_pack.find(name);
+
+	if(ptr_entry == nullptr)
+	{
+		throw std::runtime_error(std::string("Texture not found in asset pack: ") + name);
+	}
+
+	asset_pack.prefetch(*ptr_entry);
+
+	load_levels(static_cast<VkFormat>(ptr_entry->format),
+				asset_pack.get_data(*ptr_entry),
+				ptr_entry->width, ptr_entry->height,
+				ptr_entry->level_count,
+				generate_mipmaps);
+}
+
+//Uploads level_count packed levels from memory, or only creates the image when ptr_data is nullptr.
+//An empty image is left in VK_IMAGE_LAYOUT_UNDEFINED for the caller to fill.
+VulkanTexture::VulkanTexture(	Vulkan* vulkan,
+								VkFormat format,
+								uint32_t width, uint32_t height,
+								uint32_t level_count,
+								const uint8_t* ptr_data)
+{
+	vulkan_instance = vulkan;
+
+	if(ptr_data == nullptr)
+	{
+		image_format = format;
+		create_image(width, height, level_count);
+		return;
+	}
+
+	load_levels(format, ptr_data, width, height, level_count, false);
+}
+
+void VulkanTexture::load_ktx2_texture(const char* texture_file, bool generate_mipmaps)
+{
+	Ktx2Image ktx2 = load_ktx2(texture_file);
+
+	if(get_block_size(ktx2.format) == 0)
+	{
+		throw std::runtime_error(	"Unsupported KTX2 texture format " + std::to_string(ktx2.format) +
+									": " + texture_file);
+	}
+
+	//Packs the levels one after another, the layout load_levels takes.
+	std::vector<uint8_t> data;
+
+	for(uint32_t level = 0; level < ktx2.levels.size(); level++)
+	{
+		uint32_t level_width = std::max(ktx2.width >> level, 1u);
+		uint32_t level_height = std::max(ktx2.height >> level, 1u);
 
-	//Creates the vulkan image we need.
-	vulkan->create_vulkan_image(	width, height,
-									image_format,
-									VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-									VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-									VK_IMAGE_USAGE_SAMPLED_BIT,
-									image, device_memory);
+		if(ktx2.levels[level].size() != get_compressed_image_size(ktx2.format, level_width, level_height))
+		{
+			throw std::runtime_error(std::string("KTX2 level size does not match its format: ") + texture_file);
+		}
 
-	VkDeviceSize image_size = width * height * 4;
+		data.insert(data.end(), ktx2.levels[level].begin(), ktx2.levels[level].end());
+	}
+
+	load_levels(ktx2.format, data.data(), ktx2.width, ktx2.height, ktx2.levels.size(), generate_mipmaps);
+}
+
+//Block compressed levels go up as they are when the device can sample and blit the format,
+//decoded to RGBA8 on the CPU otherwise.
+void VulkanTexture::load_levels(VkFormat format,
+								const uint8_t* ptr_data,
+								uint32_t width, uint32_t height,
+								uint32_t level_count,
+								bool generate_mipmaps)
+{
+	if(get_image_size(format, width, height) == 0)
+	{
+		throw std::runtime_error("Unsupported texture format.");
+	}
+
+	if(get_block_size(format) == 0 || vulkan_instance->is_texture_format_supported(format))
+	{
+		image_format = format;
+		upload(ptr_data, width, height, level_count, generate_mipmaps);
+		return;
+	}
+
+	image_format = get_decoded_format(format);
+
+	std::vector<uint8_t> decoded;
+
+	for(uint32_t level = 0; level < level_count; level++)
+	{
+		uint32_t level_width = std::max(width >> level, 1u);
+		uint32_t level_height = std::max(height >> level, 1u);
+
+		std::vector<uint8_t> rgba;
+		decode_compressed_image(format, ptr_data, level_width, level_height, rgba);
+
+		decoded.insert(decoded.end(), rgba.begin(), rgba.end());
+		ptr_data += get_compressed_image_size(format, level_width, level_height);
+	}
+
+	upload(decoded.data(), width, height, level_count, generate_mipmaps);
+}
+
+//Creates the image in image_format from level_count mip levels packed one after another.
+//With generate_mipmaps and a single level the rest of the chain is blitted on the GPU,
+//block compressed images can't be blitted into so they keep the levels they came with.
+void VulkanTexture::upload(	const uint8_t* ptr_data,
+							uint32_t width, uint32_t height,
+							uint32_t level_count,
+							bool generate_mipmaps)
+{
+	size_t data_size = get_mip_chain_size(image_format, width, height, level_count);
+
+	upload(	width, height,
+			level_count, generate_mipmaps,
+			[ptr_data, data_size](uint8_t* ptr_staging) { memcpy(ptr_staging, ptr_data, data_size); });
+}
+
+//Same, write_levels fills the mapped staging buffer with the packed levels.
+void VulkanTexture::upload(	uint32_t width, uint32_t height,
+							uint32_t level_count,
+							bool generate_mipmaps,
+							const std::function<void(uint8_t*)>& write_levels)
+{
+	bool generate_levels = generate_mipmaps && level_count == 1 && get_block_size(image_format) == 0;
+
+	create_image(	width, height,
+					generate_levels ? static_cast<uint32_t>(floor(log2(std::max(width, height)))) + 1 : level_count);
+
+	//Level sizes are whole pixels or blocks, so every offset stays aligned for the copy.
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize image_size = 0;
+
+	for(uint32_t level = 0; level < level_count; level++)
+	{
+		uint32_t level_width = std::max(width >> level, 1u);
+		uint32_t level_height = std::max(height >> level, 1u);
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = image_size;
+		region.imageSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+		region.imageSubresource.mipLevel = level;
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {level_width, level_height, 1};
+
+		regions.push_back(region);
+		image_size += get_image_size(image_format, level_width, level_height);
+	}
 
 	VkBuffer staging_buffer;
 	VkDeviceMemory staging_buffer_memory;
 
-	vulkan->create_buffer(	image_size, 
-							VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-							staging_buffer, staging_buffer_memory);
+	vulkan_instance->create_buffer(	image_size, 
+									VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+									VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+									staging_buffer, staging_buffer_memory);
 
 	void* data;
 
-	vkMapMemory(vulkan->logical_device, staging_buffer_memory, 0, image_size, 0, &data);
-		memcpy(data, converted_surface->pixels, static_cast<size_t>(image_size));
-	vkUnmapMemory(vulkan->logical_device, staging_buffer_memory);
+	vkMapMemory(vulkan_instance->logical_device, staging_buffer_memory, 0, image_size, 0, &data);
+		write_levels(static_cast<uint8_t*>(data));
+	vkUnmapMemory(vulkan_instance->logical_device, staging_buffer_memory);
 
-	SDL_FreeSurface(converted_surface);
-
-	vulkan->exec_transition_image_layout_cmd(  	image, image_format, 
-		                                        VK_IMAGE_LAYOUT_UNDEFINED,
-		                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vulkan_instance->exec_transition_image_layout_cmd(	image, image_format, 
+														VK_IMAGE_LAYOUT_UNDEFINED,
+														VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+														mip_levels);
 
 	//Copies buffer to image.
-	vulkan->exec_copy_buffer_to_image_cmd(	staging_buffer, image,
-											width, height);
+	vulkan_instance->exec_copy_buffer_to_image_cmd(staging_buffer, image, regions);
 
-	vulkan->exec_transition_image_layout_cmd(  	image, image_format, 
-		                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	//Leaves every level as a blit source.
+	if(generate_levels)
+	{
+		vulkan_instance->exec_generate_mipmaps_cmd(image, image_format, width, height, mip_levels);
+	}
+	else
+	{
+		vulkan_instance->exec_transition_image_layout_cmd(	image, image_format, 
+															VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+															VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+															mip_levels);
+	}
 
-	image_extent = {width, height};
+	vkDestroyBuffer(vulkan_instance->logical_device, staging_buffer, nullptr);
+	vkFreeMemory(vulkan_instance->logical_device, staging_buffer_memory, nullptr);
+}
 
-	vkDestroyBuffer(vulkan->logical_device, staging_buffer, nullptr);
-	vkFreeMemory(vulkan->logical_device, staging_buffer_memory, nullptr);
+//Creates the image, its memory and view in image_format, contents and layout are left undefined.
+void VulkanTexture::create_image(uint32_t width, uint32_t height, uint32_t level_count)
+{
+	mip_levels = level_count;
+	image_extent = {width, height};
 
-	image_view = vulkan->create_image_view(image, VK_FORMAT_B8G8R8A8_SRGB);
+	vulkan_instance->create_vulkan_image(	width, height,
+											image_format,
+											VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+											VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+											VK_IMAGE_USAGE_SAMPLED_BIT,
+											image, device_memory,
+											mip_levels);
 
+	image_view = vulkan_instance->create_image_view(image, image_format, mip_levels);
 }
 
 //Destroys a texture object
@@ -0,0 +1,114 @@
+#include <filesystem>
+
+#include "Vulkan.hpp"
+#include "VulkanTextureCache.hpp"
+
+VulkanTextureCache::VulkanTextureCache(Vulkan* vulkan)
+{
+    vulkan_instance = vulkan;
+}
+
+//Everything still acquired goes too, the device is idle by the time the cache is destroyed.
+VulkanTextureCache::~VulkanTextureCache()
+{
+    for(auto& it : entries)
+    {
+        delete it.second.ptr_texture;
+    }
+}
+
+VulkanTexture* VulkanTextureCache::acquire(const char* file, bool generate_mipmaps)
+{
+    //Falls back on the path as given when it can't be resolved, loading it will report why.
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::weakly_canonical(file, error);
+
+    std::string key = error ? std::string(file) : path.string();
+
+    if(generate_mipmaps)
+    {
+        key += "#mipmaps";
+    }
+
+    auto it = entries.find(key);
+
+    if(it != entries.end())
+    {
+        hits++;
+        it->second.ref_count++;
+
+        return it->second.ptr_texture;
+    }
+
+    misses++;
+
+    Entry entry;
+    entry.ptr_texture = new VulkanTexture(vulkan_instance, file, generate_mipmaps);
+    entry.ref_count = 1;
+
+    entries[key] = entry;
+    texture_keys[entry.ptr_texture] = key;
+
+    return entry.ptr_texture;
+}
+
+void VulkanTextureCache::release(VulkanTexture* ptr_texture)
+{
+    auto it = texture_keys.find(ptr_texture);
+
+    if(it == texture_keys.end())
+    {
+        throw std::runtime_error("Released a texture the cache does not own.");
+    }
+
+    Entry& entry = entries[it->second];
+
+    if(entry.ref_count == 0)
+    {
+        throw std::runtime_error("Released a texture more times than it was acquired.");
+    }
+
+    entry.ref_count--;
+
+    if(entry.ref_count == 0)
+    {
+        entry.released_frame = frame;
+
+        if(!entry.in_released_keys)
+        {
+            entry.in_released_keys = true;
+            released_keys.push_back(it->second);
+        }
+    }
+}
+
+void VulkanTextureCache::update()
+{
+    frame++;
+
+    for(size_t i = 0; i < released_keys.size();)
+    {
+        auto it = entries.find(released_keys[i]);
+        Entry& entry = it->second;
+
+        if(entry.ref_count > 0)
+        {
+            //Acquired again before it went.
+            entry.in_released_keys = false;
+        }
+        else if(entry.released_frame + vulkan_instance->MAX_FRAMES_IN_FLIGHT <= frame)
+        {
+            texture_keys.erase(entry.ptr_texture);
+            delete entry.ptr_texture;
+            entries.erase(it);
+        }
+        else
+        {
+            i++;
+            continue;
+        }
+
+        released_keys[i] = released_keys.back();
+        released_keys.pop_back();
+    }
+}
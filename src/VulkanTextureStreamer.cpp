@@ -0,0 +1,569 @@
+#include "Vulkan.hpp"
+#include "AssetPack.hpp"
+#include "Ktx2.hpp"
+#include "TextureCodec.hpp"
+#include "PixelConvert.hpp"
+
+static const uint32_t PLACEHOLDER_SIZE = 8;
+
+VulkanTextureStreamer::VulkanTextureStreamer(   Vulkan* vulkan,
+                                                VkDeviceSize t_memory_budget,
+                                                VkDeviceSize t_upload_budget,
+                                                bool t_generate_mipmaps,
+                                                const AssetPack* t_ptr_asset_pack)
+{
+    vulkan_instance = vulkan;
+    memory_budget = t_memory_budget;
+    generate_mipmaps = t_generate_mipmaps;
+    ptr_asset_pack = t_ptr_asset_pack;
+
+    //Magenta and black checkers, hard to mistake for a real texture.
+    std::vector<uint8_t> checker(PLACEHOLDER_SIZE * PLACEHOLDER_SIZE * 4);
+
+    for(uint32_t y = 0; y < PLACEHOLDER_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < PLACEHOLDER_SIZE; x++)
+        {
+            uint8_t value = ((x / 2 + y / 2) % 2) ? 0xff : 0x00;
+            uint8_t* ptr_pixel = checker.data() + (y * PLACEHOLDER_SIZE + x) * 4;
+
+            ptr_pixel[0] = value;
+            ptr_pixel[1] = 0x00;
+            ptr_pixel[2] = value;
+            ptr_pixel[3] = 0xff;
+        }
+    }
+
+    placeholder = new VulkanTexture(    vulkan_instance,
+                                        VK_FORMAT_B8G8R8A8_SRGB,
+                                        PLACEHOLDER_SIZE, PLACEHOLDER_SIZE,
+                                        1,
+                                        checker.data());
+
+    resize_staging(t_upload_budget);
+
+    VkCommandBufferAllocateInfo allocate_info = {};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandPool = vulkan_instance->command_pool;
+    allocate_info.commandBufferCount = 1;
+
+    if(vkAllocateCommandBuffers(vulkan_instance->logical_device, &allocate_info, &upload_command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate texture upload command buffer.");
+    }
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if(vkCreateFence(vulkan_instance->logical_device, &fence_info, nullptr, &upload_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture upload fence.");
+    }
+
+    for(uint32_t i = 0; i < TEXTURE_LOADER_THREADS; i++)
+    {
+        loader_threads.emplace_back(&VulkanTextureStreamer::loader_loop, this);
+    }
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        stop_loader = true;
+    }
+
+    loader_condition.notify_all();
+
+    for(std::thread& loader_thread : loader_threads)
+    {
+        loader_thread.join();
+    }
+
+    if(upload_pending)
+    {
+        vkWaitForFences(vulkan_instance->logical_device, 1, &upload_fence, VK_TRUE, UINT64_MAX);
+    }
+
+    VkDevice device = vulkan_instance->logical_device;
+
+    vkDestroyFence(device, upload_fence, nullptr);
+    vkFreeCommandBuffers(device, vulkan_instance->command_pool, 1, &upload_command_buffer);
+
+    vkUnmapMemory(device, staging_buffer_memory);
+    vkDestroyBuffer(device, staging_buffer, nullptr);
+    vkFreeMemory(device, staging_buffer_memory, nullptr);
+
+    for(VulkanStreamedTexture* ptr_streamed : textures)
+    {
+        delete ptr_streamed->ptr_texture;
+        delete ptr_streamed;
+    }
+
+    for(LoadedTexture& loaded : upload_queue)
+    {
+        delete loaded.ptr_texture;
+    }
+
+    delete placeholder;
+}
+
+VulkanStreamedTexture* VulkanTextureStreamer::get_texture(const char* file)
+{
+    auto it = file_lookup.find(file);
+
+    if(it != file_lookup.end())
+    {
+        return it->second;
+    }
+
+    VulkanStreamedTexture* ptr_streamed = new VulkanStreamedTexture();
+    ptr_streamed->file = file;
+
+    textures.push_back(ptr_streamed);
+    file_lookup[ptr_streamed->file] = ptr_streamed;
+
+    return ptr_streamed;
+}
+
+VulkanTexture* VulkanTextureStreamer::use_texture(VulkanStreamedTexture* ptr_streamed)
+{
+    //Sprites queued between frames go out in the next draw, whose update() hasn't counted it yet.
+    //Counting the use there keeps the texture until that draw's fence has been waited on.
+    ptr_streamed->last_used_frame = frame + 1;
+
+    if(ptr_streamed->state == TEXTURE_UNLOADED)
+    {
+        ptr_streamed->state = TEXTURE_LOADING;
+
+        {
+            std::lock_guard<std::mutex> lock(loader_mutex);
+            load_queue.push_back(ptr_streamed);
+        }
+
+        loader_condition.notify_one();
+    }
+
+    return ptr_streamed->state == TEXTURE_RESIDENT ? ptr_streamed->ptr_texture : placeholder;
+}
+
+//Reads and decodes textures, the GPU side is left to update().
+void VulkanTextureStreamer::loader_loop()
+{
+    while(true)
+    {
+        VulkanStreamedTexture* ptr_streamed;
+
+        {
+            std::unique_lock<std::mutex> lock(loader_mutex);
+            loader_condition.wait(lock, [this] { return stop_loader || !load_queue.empty(); });
+
+            if(stop_loader)
+            {
+                return;
+            }
+
+            ptr_streamed = load_queue.front();
+            load_queue.pop_front();
+        }
+
+        LoadedTexture loaded;
+        loaded.ptr_streamed = ptr_streamed;
+
+        try
+        {
+            load(loaded);
+        }
+        catch(const std::exception& e)
+        {
+            loaded.error_msg = e.what();
+        }
+
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        ready_queue.push_back(std::move(loaded));
+    }
+}
+
+//Fills loaded with the exact bytes that go into staging, the same layouts VulkanTexture uploads.
+//The file name is never written after the texture is created, so it is safe to read here.
+void VulkanTextureStreamer::load(LoadedTexture& loaded)
+{
+    const std::string& file = loaded.ptr_streamed->file;
+
+    const AssetPackEntry* ptr_entry = ptr_asset_pack ? ptr_asset_pack->find(file.c_str()) : nullptr;
+
+    std::string extension = file.substr(file.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if(ptr_entry != nullptr)
+    {
+        loaded.format = static_cast<VkFormat>(ptr_entry->format);
+        loaded.width = ptr_entry->width;
+        loaded.height = ptr_entry->height;
+        loaded.level_count = ptr_entry->level_count;
+
+        const uint8_t* ptr_data = ptr_asset_pack->get_data(*ptr_entry);
+        loaded.data.assign(ptr_data, ptr_data + ptr_entry->data_size);
+    }
+    else if(extension == "ktx2")
+    {
+        Ktx2Image ktx2 = load_ktx2(file.c_str());
+
+        if(get_block_size(ktx2.format) == 0)
+        {
+            throw std::runtime_error("Unsupported KTX2 texture format: " + file);
+        }
+
+        loaded.format = ktx2.format;
+        loaded.width = ktx2.width;
+        loaded.height = ktx2.height;
+        loaded.level_count = ktx2.levels.size();
+
+        for(uint32_t level = 0; level < ktx2.levels.size(); level++)
+        {
+            uint32_t level_width = std::max(ktx2.width >> level, 1u);
+            uint32_t level_height = std::max(ktx2.height >> level, 1u);
+
+            if(ktx2.levels[level].size() != get_compressed_image_size(ktx2.format, level_width, level_height))
+            {
+                throw std::runtime_error("KTX2 level size does not match its format: " + file);
+            }
+
+            loaded.data.insert(loaded.data.end(), ktx2.levels[level].begin(), ktx2.levels[level].end());
+        }
+    }
+    else
+    {
+        SDL_Surface* img_surface = IMG_Load(file.c_str());
+
+        if(img_surface == NULL)
+        {
+            throw std::runtime_error("Error opening texture file: " + file + " " + SDL_GetError());
+        }
+
+        if(!can_convert_surface_to_bgra8(img_surface))
+        {
+            SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(img_surface, SDL_PIXELFORMAT_BGRA32, 0);
+            SDL_FreeSurface(img_surface);
+
+            if(converted_surface == NULL)
+            {
+                throw std::runtime_error("Error converting texture file: " + file + " " + SDL_GetError());
+            }
+
+            img_surface = converted_surface;
+        }
+
+        loaded.format = VK_FORMAT_B8G8R8A8_SRGB;
+        loaded.width = img_surface->w;
+        loaded.height = img_surface->h;
+        loaded.level_count = 1;
+        loaded.data.resize(size_t(loaded.width) * loaded.height * 4);
+
+        convert_surface_to_bgra8(img_surface, loaded.data.data());
+        SDL_FreeSurface(img_surface);
+    }
+
+    if(get_mip_chain_size(loaded.format, loaded.width, loaded.height, loaded.level_count) != loaded.data.size())
+    {
+        throw std::runtime_error("Texture data does not match its size: " + file);
+    }
+
+    //Decoded here rather than on the main thread when the device can't take the blocks.
+    if(get_block_size(loaded.format) != 0 && !vulkan_instance->is_texture_format_supported(loaded.format))
+    {
+        std::vector<uint8_t> decoded;
+        const uint8_t* ptr_blocks = loaded.data.data();
+
+        for(uint32_t level = 0; level < loaded.level_count; level++)
+        {
+            uint32_t level_width = std::max(loaded.width >> level, 1u);
+            uint32_t level_height = std::max(loaded.height >> level, 1u);
+
+            std::vector<uint8_t> rgba;
+            decode_compressed_image(loaded.format, ptr_blocks, level_width, level_height, rgba);
+
+            decoded.insert(decoded.end(), rgba.begin(), rgba.end());
+            ptr_blocks += get_compressed_image_size(loaded.format, level_width, level_height);
+        }
+
+        loaded.format = get_decoded_format(loaded.format);
+        loaded.data.swap(decoded);
+    }
+
+    //Built on the CPU, the upload has no spare one time command buffer to blit them with.
+    if(generate_mipmaps && loaded.level_count == 1 && get_block_size(loaded.format) == 0)
+    {
+        bool srgb = loaded.format == VK_FORMAT_B8G8R8A8_SRGB || loaded.format == VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t level_count = static_cast<uint32_t>(floor(log2(std::max(loaded.width, loaded.height)))) + 1;
+
+        std::vector<uint8_t> pixels = loaded.data;
+
+        for(uint32_t level = 1; level < level_count; level++)
+        {
+            std::vector<uint8_t> next;
+            downsample_image(   pixels.data(),
+                                std::max(loaded.width >> (level - 1), 1u),
+                                std::max(loaded.height >> (level - 1), 1u),
+                                srgb, next);
+
+            loaded.data.insert(loaded.data.end(), next.begin(), next.end());
+            pixels.swap(next);
+        }
+
+        loaded.level_count = level_count;
+    }
+}
+
+//Evicts least recently used textures until size more bytes fit in the budget.
+//Only textures no frame in flight can be reading are candidates, false when that isn't enough.
+//A texture bigger than the whole budget still goes in once nothing else is resident.
+bool VulkanTextureStreamer::make_room(VkDeviceSize size)
+{
+    while(resident_bytes + size > memory_budget)
+    {
+        VulkanStreamedTexture* ptr_oldest = nullptr;
+
+        for(VulkanStreamedTexture* ptr_streamed : textures)
+        {
+            if( ptr_streamed->state == TEXTURE_RESIDENT &&
+                ptr_streamed->last_used_frame + vulkan_instance->MAX_FRAMES_IN_FLIGHT <= frame &&
+                (ptr_oldest == nullptr || ptr_streamed->last_used_frame < ptr_oldest->last_used_frame))
+            {
+                ptr_oldest = ptr_streamed;
+            }
+        }
+
+        if(ptr_oldest == nullptr)
+        {
+            return resident_bytes == 0;
+        }
+
+        evict(ptr_oldest);
+    }
+
+    return true;
+}
+
+void VulkanTextureStreamer::evict(VulkanStreamedTexture* ptr_streamed)
+{
+    resident_bytes -= ptr_streamed->memory_size;
+
+    delete ptr_streamed->ptr_texture;
+    ptr_streamed->ptr_texture = nullptr;
+    ptr_streamed->memory_size = 0;
+    ptr_streamed->state = TEXTURE_UNLOADED;
+}
+
+//Only called while no upload is in flight.
+void VulkanTextureStreamer::resize_staging(VkDeviceSize size)
+{
+    VkDevice device = vulkan_instance->logical_device;
+
+    if(staging_buffer != VK_NULL_HANDLE)
+    {
+        vkUnmapMemory(device, staging_buffer_memory);
+        vkDestroyBuffer(device, staging_buffer, nullptr);
+        vkFreeMemory(device, staging_buffer_memory, nullptr);
+    }
+
+    staging_size = size;
+
+    vulkan_instance->create_buffer( staging_size,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                    staging_buffer,
+                                    staging_buffer_memory);
+
+    void* data;
+    vkMapMemory(device, staging_buffer_memory, 0, staging_size, 0, &data);
+    ptr_staging = static_cast<uint8_t*>(data);
+}
+
+//Creates the images of as many loaded textures as fit in staging and the budget,
+//and records their copies into a single submission.
+void VulkanTextureStreamer::submit_uploads()
+{
+    struct StagedTexture
+    {
+        VulkanTexture*                  ptr_texture;
+        std::vector<VkBufferImageCopy>  regions;
+    };
+
+    std::vector<StagedTexture> staged_textures;
+    VkDeviceSize staged = 0;
+
+    while(!upload_queue.empty())
+    {
+        LoadedTexture& loaded = upload_queue.front();
+        VulkanStreamedTexture* ptr_streamed = loaded.ptr_streamed;
+
+        if(!loaded.error_msg.empty())
+        {
+            std::cerr << loaded.error_msg << std::endl;
+            ptr_streamed->state = TEXTURE_FAILED;
+            upload_queue.pop_front();
+            continue;
+        }
+
+        //Copy offsets have to be a multiple of the texel or block size, 16 covers every format.
+        VkDeviceSize offset = (staged + 15) & ~VkDeviceSize(15);
+
+        if(offset + loaded.data.size() > staging_size)
+        {
+            if(!staged_textures.empty())
+            {
+                break;
+            }
+
+            resize_staging(loaded.data.size());
+            offset = 0;
+        }
+
+        //Images take more than their data with alignment and padding, so room is made for
+        //what the image really takes.
+        if(loaded.ptr_texture == nullptr)
+        {
+            loaded.ptr_texture = new VulkanTexture( vulkan_instance,
+                                                    loaded.format,
+                                                    loaded.width, loaded.height,
+                                                    loaded.level_count,
+                                                    nullptr);
+
+            VkMemoryRequirements memory_requirements;
+            vkGetImageMemoryRequirements(vulkan_instance->logical_device, loaded.ptr_texture->image, &memory_requirements);
+            loaded.memory_size = memory_requirements.size;
+        }
+
+        if(!make_room(loaded.memory_size))
+        {
+            break;
+        }
+
+        VulkanTexture* ptr_texture = loaded.ptr_texture;
+
+        ptr_streamed->ptr_texture = ptr_texture;
+        ptr_streamed->memory_size = loaded.memory_size;
+        ptr_streamed->state = TEXTURE_UPLOADING;
+        resident_bytes += loaded.memory_size;
+
+        memcpy(ptr_staging + offset, loaded.data.data(), loaded.data.size());
+
+        StagedTexture staged_texture;
+        staged_texture.ptr_texture = ptr_texture;
+
+        for(uint32_t level = 0; level < loaded.level_count; level++)
+        {
+            uint32_t level_width = std::max(loaded.width >> level, 1u);
+            uint32_t level_height = std::max(loaded.height >> level, 1u);
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = offset;
+            region.imageSubresource = VULKAN_SUBRESOURCE_LAYER_COLOR;
+            region.imageSubresource.mipLevel = level;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {level_width, level_height, 1};
+
+            staged_texture.regions.push_back(region);
+            offset += get_image_size(loaded.format, level_width, level_height);
+        }
+
+        staged_textures.push_back(std::move(staged_texture));
+        uploads_in_flight.push_back(ptr_streamed);
+        upload_queue.pop_front();
+
+        staged = offset;
+    }
+
+    if(staged_textures.empty())
+    {
+        return;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(upload_command_buffer, &begin_info);
+
+    for(StagedTexture& staged_texture : staged_textures)
+    {
+        VulkanTexture* ptr_texture = staged_texture.ptr_texture;
+
+        vulkan_instance->transition_image_layout_cmd(   upload_command_buffer,
+                                                        ptr_texture->image, ptr_texture->image_format,
+                                                        VK_IMAGE_LAYOUT_UNDEFINED,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                        ptr_texture->mip_levels);
+
+        vkCmdCopyBufferToImage( upload_command_buffer,
+                                staging_buffer,
+                                ptr_texture->image,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                staged_texture.regions.size(),
+                                staged_texture.regions.data());
+
+        //Sprites are blitted out of it.
+        vulkan_instance->transition_image_layout_cmd(   upload_command_buffer,
+                                                        ptr_texture->image, ptr_texture->image_format,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                        ptr_texture->mip_levels);
+    }
+
+    if(vkEndCommandBuffer(upload_command_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record texture upload command buffer.");
+    }
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &upload_command_buffer;
+
+    vkResetFences(vulkan_instance->logical_device, 1, &upload_fence);
+
+    if(vkQueueSubmit(vulkan_instance->graphics_queue, 1, &submit_info, upload_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit texture upload.");
+    }
+
+    upload_pending = true;
+}
+
+void VulkanTextureStreamer::update()
+{
+    frame++;
+
+    //The staging buffer is busy until the previous upload lands.
+    if(upload_pending)
+    {
+        if(vkGetFenceStatus(vulkan_instance->logical_device, upload_fence) != VK_SUCCESS)
+        {
+            return;
+        }
+
+        upload_pending = false;
+
+        for(VulkanStreamedTexture* ptr_streamed : uploads_in_flight)
+        {
+            ptr_streamed->state = TEXTURE_RESIDENT;
+        }
+
+        uploads_in_flight.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+
+        for(LoadedTexture& loaded : ready_queue)
+        {
+            upload_queue.push_back(std::move(loaded));
+        }
+
+        ready_queue.clear();
+    }
+
+    submit_uploads();
+}
@@ -0,0 +1,135 @@
+//Offline asset cooker: bakes textures into an asset pack, each one already in the
+//format, extent and mip layout VulkanTexture uploads, so loading needs no decoding.
+//
+//Usage: asset_cooker output.pack [--mipmaps] texture...
+//  Assets are named by the path given here, which is what the game looks them up by.
+//  PNG and any other SDL_image format become B8G8R8A8_SRGB, .ktx2 files keep their blocks and levels.
+//  --mipmaps  bakes the full mip chain of the following SDL_image textures
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <vector>
+
+#include "AssetPack.hpp"
+#include "Ktx2.hpp"
+#include "TextureCodec.hpp"
+
+static AssetPackTexture cook_ktx2(const char* file)
+{
+    Ktx2Image ktx2 = load_ktx2(file);
+
+    AssetPackTexture texture;
+    texture.name = file;
+    texture.format = ktx2.format;
+    texture.width = ktx2.width;
+    texture.height = ktx2.height;
+    texture.level_count = static_cast<uint32_t>(ktx2.levels.size());
+
+    for(const std::vector<uint8_t>& level : ktx2.levels)
+    {
+        texture.data.insert(texture.data.end(), level.begin(), level.end());
+    }
+
+    return texture;
+}
+
+static AssetPackTexture cook_image(const char* file, bool mipmaps)
+{
+    SDL_Surface* img_surface = IMG_Load(file);
+
+    if(img_surface == NULL)
+    {
+        throw std::runtime_error(std::string("Error opening image file: ") + file + " " + SDL_GetError());
+    }
+
+    //Same conversion VulkanTexture does at load time, ARGB8888 words are B, G, R, A in memory.
+    SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(img_surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(img_surface);
+
+    if(converted_surface == NULL)
+    {
+        throw std::runtime_error(std::string("Error converting image file: ") + file + " " + SDL_GetError());
+    }
+
+    AssetPackTexture texture;
+    texture.name = file;
+    texture.format = VK_FORMAT_B8G8R8A8_SRGB;
+    texture.width = converted_surface->w;
+    texture.height = converted_surface->h;
+    texture.level_count = mipmaps ? static_cast<uint32_t>(floor(log2(std::max(texture.width, texture.height)))) + 1 : 1;
+
+    std::vector<uint8_t> pixels(size_t(texture.width) * texture.height * 4);
+
+    for(uint32_t y = 0; y < texture.height; y++)
+    {
+        memcpy( pixels.data() + size_t(y) * texture.width * 4,
+                static_cast<uint8_t*>(converted_surface->pixels) + y * converted_surface->pitch,
+                texture.width * 4);
+    }
+
+    SDL_FreeSurface(converted_surface);
+
+    for(uint32_t level = 0; level < texture.level_count; level++)
+    {
+        if(level > 0)
+        {
+            std::vector<uint8_t> next;
+            downsample_image(pixels.data(), std::max(texture.width >> (level - 1), 1u), std::max(texture.height >> (level - 1), 1u), true, next);
+            pixels.swap(next);
+        }
+
+        texture.data.insert(texture.data.end(), pixels.begin(), pixels.end());
+    }
+
+    return texture;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 3)
+    {
+        std::cerr << "Usage: asset_cooker output.pack [--mipmaps] texture..." << std::endl;
+        return 1;
+    }
+
+    bool mipmaps = false;
+    std::vector<AssetPackTexture> textures;
+
+    try
+    {
+        for(int i = 2; i < argc; i++)
+        {
+            std::string file(argv[i]);
+
+            if(file == "--mipmaps")
+            {
+                mipmaps = true;
+                continue;
+            }
+
+            std::string extension = file.substr(file.find_last_of('.') + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+            textures.push_back(extension == "ktx2" ? cook_ktx2(argv[i]) : cook_image(argv[i], mipmaps));
+
+            std::cout << file << ": " << textures.back().width << "x" << textures.back().height << ", "
+                      << textures.back().level_count << " levels" << std::endl;
+        }
+
+        save_asset_pack(argv[1], textures);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
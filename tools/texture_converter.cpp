@@ -0,0 +1,137 @@
+//Offline texture converter: reads any image SDL_image can open and writes a
+//BC1 or BC3 compressed .ktx2 that VulkanTexture uploads without decoding.
+//
+//Usage: texture_converter input.png output.ktx2 [bc1|bc3] [--mipmaps] [--linear]
+//  bc1        opaque or 1 bit alpha, 4 bits per pixel
+//  bc3        full alpha, 8 bits per pixel (default)
+//  --mipmaps  stores the whole mip chain
+//  --linear   UNORM instead of SRGB, for data that isn't color
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <vector>
+
+#include "Ktx2.hpp"
+#include "TextureCodec.hpp"
+
+int main(int argc, char* argv[])
+{
+    if(argc < 3)
+    {
+        std::cerr << "Usage: texture_converter input output.ktx2 [bc1|bc3] [--mipmaps] [--linear]" << std::endl;
+        return 1;
+    }
+
+    bool bc1 = false;
+    bool mipmaps = false;
+    bool srgb = true;
+
+    for(int i = 3; i < argc; i++)
+    {
+        std::string option(argv[i]);
+
+        if(option == "bc1")
+        {
+            bc1 = true;
+        }
+        else if(option == "bc3")
+        {
+            bc1 = false;
+        }
+        else if(option == "--mipmaps")
+        {
+            mipmaps = true;
+        }
+        else if(option == "--linear")
+        {
+            srgb = false;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    SDL_Surface* img_surface = IMG_Load(argv[1]);
+
+    if(img_surface == NULL)
+    {
+        std::cerr << "Error opening image file: " << argv[1] << " " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    //RGBA32 is R, G, B, A in memory whatever the endianness.
+    SDL_Surface* converted_surface = SDL_ConvertSurfaceFormat(img_surface, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(img_surface);
+
+    if(converted_surface == NULL)
+    {
+        std::cerr << "Error converting image file to RGBA: " << argv[1] << " " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    uint32_t width = converted_surface->w;
+    uint32_t height = converted_surface->h;
+
+    std::vector<uint8_t> rgba(size_t(width) * height * 4);
+
+    for(uint32_t y = 0; y < height; y++)
+    {
+        memcpy(rgba.data() + size_t(y) * width * 4, static_cast<uint8_t*>(converted_surface->pixels) + y * converted_surface->pitch, width * 4);
+    }
+
+    SDL_FreeSurface(converted_surface);
+
+    Ktx2Image image;
+    image.width = width;
+    image.height = height;
+
+    if(bc1)
+    {
+        image.format = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    }
+    else
+    {
+        image.format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+
+    uint32_t level_count = mipmaps ? static_cast<uint32_t>(floor(log2(std::max(width, height)))) + 1 : 1;
+
+    try
+    {
+        for(uint32_t level = 0; level < level_count; level++)
+        {
+            uint32_t level_width = std::max(width >> level, 1u);
+            uint32_t level_height = std::max(height >> level, 1u);
+
+            if(level > 0)
+            {
+                std::vector<uint8_t> next;
+                downsample_image(rgba.data(), std::max(width >> (level - 1), 1u), std::max(height >> (level - 1), 1u), srgb, next);
+                rgba.swap(next);
+            }
+
+            image.levels.emplace_back();
+            encode_compressed_image(image.format, rgba.data(), level_width, level_height, image.levels.back());
+        }
+
+        save_ktx2(argv[2], image);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << width << "x" << height << ", " << level_count << " levels" << std::endl;
+
+    return 0;
+}